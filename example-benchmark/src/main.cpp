@@ -0,0 +1,28 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+//========================================================================
+int main(int argc, char* argv[]){
+
+	// no window and no GL context, the benchmark only exercises the pixel path
+	// so it can run on a headless build machine
+	ofAppNoWindow window;
+	ofSetupOpenGL(&window, 1024, 768, OF_WINDOW);
+
+	ofApp* app = new ofApp();
+	for(int i = 1; i < argc; i++){
+		string arg = argv[i];
+		if(arg == "--frames" && i + 1 < argc){
+			app->numFrames = ofToInt(argv[++i]);
+		}
+		else if(arg == "--quick"){
+			app->quick = true;
+		}
+		else if(arg == "--keep"){
+			app->keepGenerated = true;
+		}
+	}
+	ofRunApp(app);
+
+}
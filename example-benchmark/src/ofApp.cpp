@@ -0,0 +1,272 @@
+/**
+ *  ofApp.cpp
+ *
+ *	ofxImageSequence headless benchmark, see ofApp.h for usage
+ */
+
+#include "ofApp.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef TARGET_OSX
+#include <mach/mach.h>
+#endif
+
+//--------------------------------------------------------------
+ofApp::ofApp(){
+	numFrames = 120;
+	quick = false;
+	keepGenerated = false;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+
+	struct Config {
+		int width;
+		int height;
+		string format;
+	};
+
+	vector<Config> configs;
+	Config small	= { 640,  360,  "jpg" };	configs.push_back(small);
+	Config smallPng	= { 640,  360,  "png" };	configs.push_back(smallPng);
+	if(!quick){
+		Config hd	= { 1920, 1080, "jpg" };	configs.push_back(hd);
+		Config hdPng= { 1920, 1080, "png" };	configs.push_back(hdPng);
+		Config uhd	= { 3840, 2160, "png" };	configs.push_back(uhd);
+	}
+
+	for(int i = 0; i < configs.size(); i++){
+		string folder = generateSequence(configs[i].width, configs[i].height, configs[i].format, numFrames);
+		runSequence(ofFilePath::getFileName(folder), folder);
+		if(!keepGenerated){
+			ofDirectory(folder).remove(true);
+			ofFile::removeFile(ofxImageSequenceManifest::getPathForFolder(folder));
+		}
+	}
+
+	report();
+	ofExit();
+}
+
+//--------------------------------------------------------------
+string ofApp::generateSequence(int width, int height, string format, int frames){
+
+	string folder = "benchmark/" + ofToString(width) + "x" + ofToString(height) + "_" + format + "_" + ofToString(frames);
+	ofDirectory::createDirectory(folder, true, true);
+
+	//a moving gradient with noise so the encoders have realistic work to do. png frames get an alpha channel
+	int channels = format == "png" ? 4 : 3;
+	ofPixels pixels;
+	pixels.allocate(width, height, channels);
+	ofSeedRandom(0);
+	for(int f = 0; f < frames; f++){
+		string path = folder + "/frame" + ofToString(f, 5, '0') + "." + format;
+		if(ofFile(path).exists()){
+			continue;
+		}
+		unsigned char* data = pixels.getData();
+		for(int y = 0; y < height; y++){
+			for(int x = 0; x < width; x++){
+				unsigned char* pixel = data + (y * width + x) * channels;
+				pixel[0] = (x + f * 4) & 0xFF;
+				pixel[1] = (y + f * 2) & 0xFF;
+				pixel[2] = (int)ofRandom(256);
+				if(channels == 4){
+					pixel[3] = (x * 255) / width;
+				}
+			}
+		}
+		ofSaveImage(pixels, path, OF_IMAGE_QUALITY_HIGH);
+	}
+
+	ofLogNotice("benchmark") << "generated " << folder;
+	return folder;
+}
+
+//--------------------------------------------------------------
+void ofApp::runSequence(string name, string folder){
+
+	vector<uint64_t> latencies;
+
+	//open, with and without header probing
+	{
+		ofxImageSequence sequence;
+		sequence.setUseTexture(false);
+		uint64_t start = ofGetElapsedTimeMicros();
+		sequence.loadSequence(folder);
+		addResult(name, "load", 1, ofGetElapsedTimeMicros() - start, latencies);
+	}
+	{
+		ofxImageSequence sequence;
+		sequence.setUseTexture(false);
+		sequence.enableLazyOpen(true);
+		uint64_t start = ofGetElapsedTimeMicros();
+		sequence.loadSequence(folder);
+		addResult(name, "load lazy", 1, ofGetElapsedTimeMicros() - start, latencies);
+	}
+
+	//the first load writes the manifest, the second is the repeat startup that reuses it
+	for(int i = 0; i < 2; i++){
+		ofxImageSequence sequence;
+		sequence.setUseTexture(false);
+		sequence.enableManifest(true);
+		uint64_t start = ofGetElapsedTimeMicros();
+		sequence.loadSequence(folder);
+		addResult(name, sequence.isLoadedFromManifest() ? "load manifest" : "load write manifest", 1, ofGetElapsedTimeMicros() - start, latencies);
+	}
+
+	//bulk preload, serial and across every core
+	int threadCounts[] = { 1, 0 };
+	for(int i = 0; i < 2; i++){
+		ofxImageSequence sequence;
+		sequence.setUseTexture(false);
+		sequence.enableLazyOpen(true);
+		sequence.setNumLoadThreads(threadCounts[i]);
+		sequence.loadSequence(folder);
+		uint64_t start = ofGetElapsedTimeMicros();
+		sequence.preloadAllFrames();
+		addResult(name, "preload x" + ofToString(sequence.getNumLoadThreads()), sequence.getTotalFrames(), ofGetElapsedTimeMicros() - start, latencies);
+	}
+
+	//cold playback and scrubbing, every frame decoded on demand
+	ofxImageSequence sequence;
+	sequence.setUseTexture(false);
+	sequence.enableLazyOpen(true);
+	sequence.loadSequence(folder);
+	int total = sequence.getTotalFrames();
+
+	vector<int> forward, reverse, scrub;
+	for(int i = 0; i < total; i++){
+		forward.push_back(i);
+		reverse.push_back(total - 1 - i);
+		scrub.push_back((int)ofRandom(total));
+	}
+
+	timeFrames(name, "forward", sequence, forward);
+	sequence.unloadSequence();
+	sequence.loadSequence(folder);
+	timeFrames(name, "reverse", sequence, reverse);
+	sequence.unloadSequence();
+	sequence.loadSequence(folder);
+	timeFrames(name, "scrub", sequence, scrub);
+
+	//same patterns with the read-ahead prefetcher running
+	sequence.unloadSequence();
+	sequence.enablePrefetch(true);
+	sequence.loadSequence(folder);
+	timeFrames(name, "forward prefetch", sequence, forward);
+	sequence.unloadSequence();
+	sequence.loadSequence(folder);
+	timeFrames(name, "reverse prefetch", sequence, reverse);
+
+	//a small decoded cache over a compressed tier, the first pass fills the tier and the second is served from it
+	sequence.unloadSequence();
+	sequence.enablePrefetch(false);
+	sequence.setCacheMaxFrames(8);
+	sequence.setCompressedCacheBudgetBytes(1024 * 1024 * 1024);
+	sequence.loadSequence(folder);
+	timeFrames(name, "scrub fill compressed", sequence, scrub);
+	timeFrames(name, "scrub compressed", sequence, scrub);
+	ofLogNotice("benchmark") << name << " compression ratio " << sequence.getCompressionRatio();
+}
+
+//--------------------------------------------------------------
+void ofApp::timeFrames(string name, string pattern, ofxImageSequence& sequence, const vector<int>& frames){
+
+	vector<uint64_t> latencies;
+	uint64_t start = ofGetElapsedTimeMicros();
+	for(int i = 0; i < frames.size(); i++){
+		uint64_t frameStart = ofGetElapsedTimeMicros();
+		sequence.setFrame(frames[i]);
+		latencies.push_back(ofGetElapsedTimeMicros() - frameStart);
+	}
+	addResult(name, pattern, frames.size(), ofGetElapsedTimeMicros() - start, latencies);
+}
+
+//--------------------------------------------------------------
+void ofApp::addResult(string name, string pattern, int frames, uint64_t micros, vector<uint64_t>& latencies){
+
+	Result result;
+	result.sequence = name;
+	result.pattern = pattern;
+	result.frames = frames;
+	result.seconds = micros / 1000000.0;
+	result.framesPerSecond = micros > 0 ? frames * 1000000.0 / micros : 0;
+	result.p50 = result.p95 = result.p99 = 0;
+	if(latencies.size() > 0){
+		sort(latencies.begin(), latencies.end());
+		result.p50 = latencies[(latencies.size() - 1) * 50 / 100] / 1000.0;
+		result.p95 = latencies[(latencies.size() - 1) * 95 / 100] / 1000.0;
+		result.p99 = latencies[(latencies.size() - 1) * 99 / 100] / 1000.0;
+	}
+	result.rssKb = getRssKb();
+	result.processPeakRssKb = getProcessPeakRssKb();
+	results.push_back(result);
+
+	ofLogNotice("benchmark") << name << " " << pattern << ": " << result.framesPerSecond << " fps";
+}
+
+//--------------------------------------------------------------
+void ofApp::report(){
+
+	stringstream csv;
+	csv << "sequence,pattern,frames,seconds,fps,p50_ms,p95_ms,p99_ms,rss_kb,process_peak_rss_kb" << endl;
+	for(int i = 0; i < results.size(); i++){
+		Result& r = results[i];
+		csv << r.sequence << "," << r.pattern << "," << r.frames << "," << r.seconds << "," << r.framesPerSecond << ","
+			<< r.p50 << "," << r.p95 << "," << r.p99 << "," << r.rssKb << "," << r.processPeakRssKb << endl;
+	}
+
+	cout << csv.str();
+
+	ofstream out(ofToDataPath("benchmark_results.csv").c_str());
+	out << csv.str();
+}
+
+//--------------------------------------------------------------
+uint64_t ofApp::getRssKb(){
+#ifdef TARGET_WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.WorkingSetSize / 1024;
+#elif defined(TARGET_OSX)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS){
+		return 0;
+	}
+	return info.resident_size / 1024;
+#else
+	//second field is the resident set in pages
+	ifstream statm("/proc/self/statm");
+	uint64_t size = 0, resident = 0;
+	if(!(statm >> size >> resident)){
+		return 0;
+	}
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+}
+
+//--------------------------------------------------------------
+uint64_t ofApp::getProcessPeakRssKb(){
+#ifdef TARGET_WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef TARGET_OSX
+	return usage.ru_maxrss / 1024;	//bytes on mac
+#else
+	return usage.ru_maxrss;			//kilobytes on linux
+#endif
+#endif
+}
@@ -0,0 +1,57 @@
+/**
+ *
+ *	ofxImageSequence headless benchmark
+ *
+ *  Generates synthetic sequences at a few resolutions and formats, then times loading,
+ *  preloading, playback and scrubbing through the pixel path and reports frames per second,
+ *  latency percentiles and memory. Runs without a window so it can be used to catch
+ *  regressions on a build machine with no GPU.
+ *
+ *	usage: example-benchmark [--frames N] [--quick] [--keep]
+ *		--frames N	frames per generated sequence, default is 120
+ *		--quick		only the smallest resolution
+ *		--keep		don't delete the generated sequences afterwards
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxImageSequence.h"
+
+class ofApp : public ofBaseApp
+{
+
+  public:
+	ofApp();
+
+	void setup();
+
+	int numFrames;
+	bool quick;
+	bool keepGenerated;
+
+  protected:
+	struct Result {
+		string sequence;
+		string pattern;
+		int frames;
+		float seconds;
+		float framesPerSecond;
+		float p50;
+		float p95;
+		float p99;
+		uint64_t rssKb;				//resident right after the pattern, with its sequence still loaded
+		uint64_t processPeakRssKb;	//highest the whole process has reached so far, never goes down
+	};
+
+	string generateSequence(int width, int height, string format, int frames);
+	void runSequence(string name, string folder);
+	void timeFrames(string name, string pattern, ofxImageSequence& sequence, const vector<int>& frames);
+	void addResult(string name, string pattern, int frames, uint64_t micros, vector<uint64_t>& latencies);
+	void report();
+
+	static uint64_t getRssKb();
+	static uint64_t getProcessPeakRssKb();
+
+	vector<Result> results;
+};
@@ -45,6 +45,7 @@ void ofApp::setup(){
 	//sequence.loadSequence("frame", "png", 1, 11, 2);
 	//sequence.preloadAllFrames();	//this way there is no stutter when loading frames
 	sequence.enableThreadedLoad(true);
+	sequence.enableAsyncFrames(true);	//show the nearest decoded frame instead of stalling on ones the load hasn't reached
 	sequence.setExtension("png");
 	sequence.loadSequence("frames");
 
@@ -61,11 +62,9 @@ void ofApp::update(){
 //--------------------------------------------------------------
 void ofApp::draw(){
 	
-	if(sequence.isLoading()){
-		ofBackground(255,0,0);
-	}
-	else{
-		ofBackground(0);
+	ofBackground(0);
+	//frames can be drawn as soon as the folder is listed, while the rest are still decoding
+	if(sequence.isLoaded()){
 		if(playing){
 			//get the frame based on the current time and draw it
 			sequence.getFrameForTime(ofGetElapsedTimef())->draw(0,0);
@@ -78,12 +77,32 @@ void ofApp::draw(){
 			sequence.getFrameAtPercent(percent)->draw(0, 0);
 		}
 	}
+
+	if(sequence.isLoading() || sequence.isLoadCancelled()){
+		//one tick per frame along the bottom, red until it's decoded
+		vector<bool> ready = sequence.getReadyFrames();
+		float tickWidth = ready.size() > 0 ? 1.0 * ofGetWidth() / ready.size() : 0;
+		for(int i = 0; i < ready.size(); i++){
+			ofSetColor(ready[i] ? ofColor(0, 255, 0) : ofColor(255, 0, 0));
+			ofDrawRectangle(i * tickWidth, ofGetHeight() - 10, MAX(tickWidth, 1), 10);
+		}
+		ofSetColor(255);
+		ofDrawBitmapString(sequence.isLoading() ? "loading, c to cancel" : "cancelled, r to resume", 10, ofGetHeight() - 20);
+	}
 }
 
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
-	//hit any key to toggle playing
-	playing = !playing;
+	if(key == 'c'){
+		sequence.cancelLoad();
+	}
+	else if(key == 'r'){
+		sequence.resumeLoad();
+	}
+	else{
+		//hit any other key to toggle playing
+		playing = !playing;
+	}
 }
 
 //--------------------------------------------------------------
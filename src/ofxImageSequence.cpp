@@ -43,309 +43,2781 @@
 
 #include "ofxImageSequence.h"
 
-class ofxImageSequenceLoader : public ofThread
+#ifndef TARGET_WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+//tracks a threaded load. the work runs on the shared decode scheduler, this opens the sequence from the update
+//event as soon as the folder is listed so frames can be shown while the rest are still decoding
+class ofxImageSequenceLoader
 {
   public:
 
 	bool loading;
+	bool listing;			//a worker is reading the folder
+	bool listed;
 	bool cancelLoading;
+	bool listening;
 	ofxImageSequence& sequenceRef;
-	
+
 	ofxImageSequenceLoader(ofxImageSequence* seq)
-	: sequenceRef(*seq)
-	, loading(true)
+	: loading(true)
+	, listing(false)
+	, listed(false)
 	, cancelLoading(false)
+	, listening(true)
+	, sequenceRef(*seq)
 	{
-		startThread(true);
-	}
-	
-	~ofxImageSequenceLoader(){
-        cancel();
-    }
-	
-    void cancel(){
-		if(loading){
-			ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
-            lock();
-			cancelLoading = true;
-            unlock();
-            loading = false;
-			waitForThread(true);
-		}
-    }
-    
-	void threadedFunction(){
-	
 		ofAddListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
+	}
 
-		if(!sequenceRef.preloadAllFilenames()){
-			loading = false;
-			return;
-		}
+	~ofxImageSequenceLoader(){
+		stopListening();
+	}
 
-		if(cancelLoading){
-			loading = false;
-			cancelLoading = false;
-			return;
+	void stopListening(){
+		if(listening){
+			ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
+			listening = false;
 		}
-	
-		sequenceRef.preloadAllFrames();
-	
-		loading = false;
 	}
 
 	void updateThreadedLoad(ofEventArgs& args){
-		if(loading){
-			return;
+		bool ready;
+		bool done;
+		{
+			ofScopedLock lock(sequenceRef.loadMutex);
+			ready = listed && !listing;
+			done = !loading;
 		}
-		ofRemoveListener(ofEvents().update, this, &ofxImageSequenceLoader::updateThreadedLoad);
 
-		if(sequenceRef.getTotalFrames() > 0){
+		if(ready && !sequenceRef.isLoaded() && sequenceRef.getTotalFrames() > 0){
 			sequenceRef.completeLoading();
 		}
+		if(done){
+			stopListening();
+		}
+	}
+
+};
+
+//offers a sequence's decode work to the shared scheduler
+class ofxImageSequenceJobs : public ofxImageSequenceScheduler::Source
+{
+  public:
+
+	ofxImageSequence& sequenceRef;
+
+	ofxImageSequenceJobs(ofxImageSequence* seq)
+	: sequenceRef(*seq)
+	{
+	}
+
+	bool hasJob(ofxImageSequenceScheduler::Priority priority){
+		return sequenceRef.hasScheduledJob(priority);
+	}
+
+	bool runJob(ofxImageSequenceScheduler::Priority priority){
+		return sequenceRef.runScheduledJob(priority);
+	}
+
+	int getQuota(ofxImageSequenceScheduler::Priority priority){
+		return sequenceRef.getSchedulerQuota(priority);
+	}
+
+};
+
+//box filters an 8 bit image down by an integer factor
+static void downsamplePixels(const ofPixels& src, ofPixels& dst, int factor)
+{
+	int srcWidth = src.getWidth();
+	int srcHeight = src.getHeight();
+	int channels = src.getNumChannels();
+	int dstWidth = MAX(srcWidth / factor, 1);
+	int dstHeight = MAX(srcHeight / factor, 1);
+	dst.allocate(dstWidth, dstHeight, src.getPixelFormat());
+
+	const unsigned char* in = src.getData();
+	unsigned char* out = dst.getData();
+	vector<int> sums(channels);
+	for(int y = 0; y < dstHeight; y++){
+		int y0 = y * factor;
+		int y1 = MIN(y0 + factor, srcHeight);
+		for(int x = 0; x < dstWidth; x++){
+			int x0 = x * factor;
+			int x1 = MIN(x0 + factor, srcWidth);
+			fill(sums.begin(), sums.end(), 0);
+			for(int sy = y0; sy < y1; sy++){
+				const unsigned char* row = in + ((size_t)sy * srcWidth + x0) * channels;
+				for(int sx = x0; sx < x1; sx++){
+					for(int c = 0; c < channels; c++){
+						sums[c] += *row++;
+					}
+				}
+			}
+			int count = (y1 - y0) * (x1 - x0);
+			for(int c = 0; c < channels; c++){
+				*out++ = sums[c] / count;
+			}
+		}
 	}
+}
 
+//a file name split around the last run of digits before its extension, frame0042.png -> "frame", 42, ".png"
+struct ofxImageSequenceEntry {
+	string name;
+	string prefix;
+	string suffix;
+	int number;		//-1 when the name has no frame number
+	int digits;
 };
 
+static ofxImageSequenceEntry parseEntry(const char* name)
+{
+	ofxImageSequenceEntry entry;
+	entry.name = name;
+	entry.number = -1;
+	entry.digits = 0;
+
+	size_t end = entry.name.find_last_of('.');
+	if(end == string::npos || end == 0){
+		end = entry.name.size();
+	}
+	while(end > 0 && !isdigit((unsigned char)name[end-1])){
+		end--;
+	}
+	size_t start = end;
+	while(start > 0 && isdigit((unsigned char)name[start-1])){
+		start--;
+	}
+
+	//longer runs than this are timestamps or hashes rather than frame numbers
+	if(end == start || end - start > 9){
+		entry.prefix = entry.name;
+		return entry;
+	}
+	entry.prefix = entry.name.substr(0, start);
+	entry.suffix = entry.name.substr(end);
+	entry.number = atoi(name + start);
+	entry.digits = end - start;
+	return entry;
+}
+
+//natural order, frame9.png comes before frame10.png
+static bool entryBefore(const ofxImageSequenceEntry& a, const ofxImageSequenceEntry& b)
+{
+	if(a.prefix != b.prefix){
+		return a.prefix < b.prefix;
+	}
+	if(a.number != b.number){
+		return a.number < b.number;
+	}
+	if(a.suffix != b.suffix){
+		return a.suffix < b.suffix;
+	}
+	return a.name < b.name;
+}
+
+static int countDigits(int number)
+{
+	int digits = 1;
+	while(number >= 10){
+		number /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+//calls back with the name of every visible file in a folder, without the ofFile per entry that ofDirectory builds
+static bool listFolder(const string& folder, const function<void(const char*)>& callback)
+{
+#ifdef TARGET_WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((folder + "\\*").c_str(), &data);
+	if(find == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	do{
+		if(data.cFileName[0] != '.' && !(data.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN))){
+			callback(data.cFileName);
+		}
+	} while(FindNextFileA(find, &data));
+	FindClose(find);
+	return true;
+#else
+	DIR* dir = opendir(folder.c_str());
+	if(dir == NULL){
+		return false;
+	}
+	struct dirent* entry;
+	while((entry = readdir(dir)) != NULL){
+		if(entry->d_name[0] == '.'){
+			continue;
+		}
+		//only filesystems that don't report the type, or links, need a stat
+		bool isFile = entry->d_type == DT_REG;
+		if(entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK){
+			struct stat info;
+			isFile = stat((folder + "/" + entry->d_name).c_str(), &info) == 0 && S_ISREG(info.st_mode);
+		}
+		if(isFile){
+			callback(entry->d_name);
+		}
+	}
+	closedir(dir);
+	return true;
+#endif
+}
+
 ofxImageSequence::ofxImageSequence()
 {
 	loaded = false;
 	useThread = false;
+	lazyOpen = false;
+	useSharedCache = false;
+	useTexture = true;
+	width = 0;
+	height = 0;
+	numChannels = 0;
 	frameRate = 30.0f;
 	lastFrameLoaded = -1;
 	currentFrame = 0;
 	maxFrames = 0;
-	curLoadFrame = 0;
+	frameRangeFirst = 0;
+	frameRangeLast = -1;
+	frameStride = 1;
+	loadRangeFirst = 0;
+	loadRangeLast = -1;
+	loadStride = 1;
+	sourceFirst = 0;
+	sourceStride = 1;
+	compactNames = false;
+	nameDigits = 0;
+	pixelLayout = PIXELS_NATIVE;
+	premultiplied = false;
+	alphaTrim = false;
+	untrimmedWidth = 0;
+	untrimmedHeight = 0;
+	deltaInterval = 0;
+	deltaCanvasFrame = -1;
+	useManifest = false;
+	loadedFromManifest = false;
+	manifestDirty = false;
+	nextPreloadFrame = 0;
+	framesPreloaded = 0;
+	numLoadThreads = 1;
+	loadThrottle = THROTTLE_NONE;
+	loadThrottleAmount = 0;
+	nextThrottleSlot = 0;
+	cacheBudgetBytes = 0;
+	cacheMaxFrames = 0;
+	cacheResidentBytes = 0;
+	cacheHits = 0;
+	cacheMisses = 0;
+	cacheEvictions = 0;
+	compressedBudgetBytes = 0;
+	compressedResidentBytes = 0;
+	compressedSourceBytes = 0;
+	compressedHits = 0;
+	prefetchEnabled = false;
+	prefetchWindow = 8;
+	playheadStep = 0;
+	playheadPingPong = false;
+	playheadScrubbing = false;
+	asyncFrames = false;
+	requestedFrame = -1;
+	listeningToUpdate = false;
+	streaming = false;
+	streamingBehind = 0;
+	streamingAhead = 0;
+	savedCacheMaxFrames = 0;
+	savedPrefetchEnabled = false;
+	savedPrefetchWindow = 0;
+	proxyScale = PROXY_NONE;
+	proxiesOnDisk = false;
+	showingProxy = false;
+	buildingProxies = false;
+	nextProxyFrame = 0;
+	jobs = NULL;
 	threadLoader = NULL;
+	preloading = false;
+	preloadJobsRunning = 0;
+	loadCancelled = false;
+}
+
+ofxImageSequence::~ofxImageSequence()
+{
+	enableAsyncFrames(false);
+	enableProxies(PROXY_NONE);
+	unloadSequence();
+}
+
+bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit)
+{
+	return loadSequence(prefix, filetype, startDigit, endDigit, 0);
+}
+
+bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit, int numDigits)
+{
+	return loadSequence(prefix, filetype, startDigit, endDigit, numDigits, frameStride);
+}
+
+bool ofxImageSequence::loadSequence(string prefix, string filetype, int startDigit, int endDigit, int numDigits, int stride)
+{
+	unloadSequence();
+	setLoadSelection(frameRangeFirst, frameRangeLast, stride);
+
+	int numFiles = endDigit - startDigit+1;
+	if(numFiles <= 0 ){
+		ofLogError("ofxImageSequence::loadSequence") << "No image files found.";
+		return false;
+	}
+
+	int first, count;
+	if(!selectFrames(numFiles, first, count)){
+		ofLogError("ofxImageSequence::loadSequence") << "No frames between " << startDigit << " and " << endDigit << " in the frame range";
+		return false;
+	}
+
+	//an int frame number never needs more than 10 digits, wider padding belongs in the prefix
+	if(numDigits < 0 || numDigits > 10){
+		ofLogWarning("ofxImageSequence::loadSequence") << "numDigits " << numDigits << " is out of range, padding to " << MAX(MIN(numDigits, 10), 0) << " digits";
+	}
+
+	compactNames = true;
+	namePrefix = prefix;
+	nameSuffix = "." + filetype;
+	nameDigits = MAX(MIN(numDigits, 10), 0);
+	reserveFrames(count);
+	for(int i = 0; i < count; i++){
+		addFrame(startDigit + first + i * loadStride);
+	}
+	
+	completeLoading();
+	return true;
+}
+
+bool ofxImageSequence::loadSequence(string _folder)
+{
+	return loadSequence(_folder, frameRangeFirst, frameRangeLast, frameStride);
+}
+
+bool ofxImageSequence::loadSequence(string _folder, int firstFrame, int lastFrame, int stride)
+{
+	unloadSequence();
+	setLoadSelection(firstFrame, lastFrame, stride);
+
+	folderToLoad = _folder;
+
+	if(useThread){
+		//listing the folder is the first preload job, frames follow once it's done
+		threadLoader = new ofxImageSequenceLoader(this);
+		scheduleJobs();
+		return true;
+	}
+
+	if(preloadAllFilenames()){
+		completeLoading();
+		return true;
+	}
+	
+	return false;
+
+}
+
+void ofxImageSequence::completeLoading()
+{
+
+	if(sequence.size() == 0){
+		ofLogError("ofxImageSequence::completeLoading") << "load failed with empty image sequence";
+		return;
+	}
+
+	loaded = true;	
+	lastFrameLoaded = -1;
+
+	//lazy open only needs the size, the first frame gets decoded when something asks for it.
+	//a manifest already knows the size so there's no reason to wait on the first frame either
+	if((lazyOpen || loadedFromManifest) && probeFrameSize(0)){
+		return;
+	}
+
+	loadFrame(0);
+	
+	width  = sequence[0].getWidth();
+	height = sequence[0].getHeight();
+	numChannels = sequence[0].getNumChannels();
+	if(alphaTrim && untrimmedWidth > 0){
+		width = untrimmedWidth;
+		height = untrimmedHeight;
+	}
+
+}
+
+//reads just enough of a PNG or JPEG file to find its size, without decoding any pixels
+static bool readImageHeader(string path, int& width, int& height, int& channels)
+{
+	ifstream in(ofToDataPath(path).c_str(), ios::binary);
+	vector<unsigned char> header(64 * 1024);
+	in.read((char*)&header[0], header.size());
+	size_t size = in.gcount();
+	const unsigned char* bytes = &header[0];
+
+	static const unsigned char pngSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	if(size >= 26 && memcmp(bytes, pngSignature, 8) == 0 && memcmp(bytes + 12, "IHDR", 4) == 0){
+		width  = (bytes[16] << 24) | (bytes[17] << 16) | (bytes[18] << 8) | bytes[19];
+		height = (bytes[20] << 24) | (bytes[21] << 16) | (bytes[22] << 8) | bytes[23];
+		switch(bytes[25]){
+			case 0: channels = 1; break;	//gray
+			case 4: channels = 2; break;	//gray alpha
+			case 6: channels = 4; break;	//rgba
+			default: channels = 3; break;	//rgb and palette
+		}
+		return true;
+	}
+
+	if(size >= 4 && bytes[0] == 0xFF && bytes[1] == 0xD8){
+		size_t pos = 2;
+		while(pos + 9 < size){
+			if(bytes[pos] != 0xFF){
+				return false;
+			}
+			unsigned char marker = bytes[pos + 1];
+			if(marker == 0xFF){
+				pos++;
+				continue;
+			}
+			int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+			//any start of frame marker except huffman tables, arithmetic coding conditioning and JPEG extensions
+			if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC){
+				height   = (bytes[pos + 5] << 8) | bytes[pos + 6];
+				width    = (bytes[pos + 7] << 8) | bytes[pos + 8];
+				channels = bytes[pos + 9];
+				return true;
+			}
+			pos += 2 + length;
+		}
+	}
+
+	return false;
+}
+
+bool ofxImageSequence::probeFrameSize(int imageIndex)
+{
+	int probedWidth = 0;
+	int probedHeight = 0;
+	int probedChannels = 0;
+
+	if(rawFile.isOpen()){
+		probedWidth = rawFile.getWidth();
+		probedHeight = rawFile.getHeight();
+		probedChannels = rawFile.getNumChannels();
+	}
+	else if(packedFile.isOpen()){
+		probedWidth = packedFile.getWidth();
+		probedHeight = packedFile.getHeight();
+		probedChannels = packedFile.getNumChannels();
+	}
+	else if(loadedFromManifest && manifest.width > 0){
+		probedWidth = manifest.width;
+		probedHeight = manifest.height;
+		probedChannels = manifest.channels;
+	}
+	else if(!readImageHeader(getFramePath(imageIndex), probedWidth, probedHeight, probedChannels)){
+		return false;
+	}
+
+	if(probedWidth <= 0 || probedHeight <= 0){
+		return false;
+	}
+
+	width = probedWidth;
+	height = probedHeight;
+	numChannels = probedChannels;
+	if(pixelLayout != PIXELS_NATIVE && !rawFile.isOpen()){
+		numChannels = 4;
+	}
+	return true;
+}
+
+bool ofxImageSequence::preloadAllFilenames()
+{
+	if(!ofFile(folderToLoad).exists()){
+		ofLogError("ofxImageSequence::loadSequence") << "Could not find folder " << folderToLoad;
+		return false;
+	}
+
+	if(ofFile(folderToLoad).isFile()){
+		if(ofxImageSequenceRawFile::isRawFile(folderToLoad)){
+			return preloadRawFilenames();
+		}
+		if(ofxImageSequencePackedFile::isPackedFile(folderToLoad)){
+			return preloadPackedFilenames();
+		}
+		ofLogError("ofxImageSequence::loadSequence") << folderToLoad << " is not an image sequence file";
+		return false;
+	}
+
+	//taken before the scan so a change during it invalidates the manifest rather than going unnoticed
+	uint64_t folderSize, folderModified = 0;
+	if(useManifest){
+		if(manifest.load(ofxImageSequenceManifest::getPathForFolder(folderToLoad)) && manifest.matches(folderToLoad, extension, maxFrames, loadRangeFirst, loadRangeLast, loadStride)){
+			return preloadManifestFilenames();
+		}
+		ofxImageSequenceManifest::getFileStats(folderToLoad, folderSize, folderModified);
+	}
+
+	string allowedExtension = ofToLower(extension);
+	if(allowedExtension.size() > 0 && allowedExtension[0] == '.'){
+		allowedExtension.erase(0, 1);
+	}
+
+	//with a frame range or limit only the entries up to the last frame they could select are kept, in a heap with
+	//the last of them on top. frames before the range are held just long enough to find where the range starts
+	int keep = loadRangeLast >= 0 ? loadRangeLast + 1 : 0;
+	if(maxFrames > 0){
+		int lastSelectable = loadRangeFirst + (maxFrames - 1) * loadStride;
+		keep = keep > 0 ? MIN(keep, lastSelectable + 1) : lastSelectable + 1;
+	}
+	vector<ofxImageSequenceEntry> entries;
+	listFolder(ofToDataPath(folderToLoad), [&](const char* name){
+		if(allowedExtension != ""){
+			const char* dot = strrchr(name, '.');
+			if(dot == NULL || ofToLower(dot + 1) != allowedExtension){
+				return;
+			}
+		}
+
+		ofxImageSequenceEntry entry = parseEntry(name);
+		if(keep <= 0){
+			entries.push_back(entry);
+		}
+		else if(entries.size() < keep){
+			entries.push_back(entry);
+			push_heap(entries.begin(), entries.end(), entryBefore);
+		}
+		else if(entryBefore(entry, entries.front())){
+			pop_heap(entries.begin(), entries.end(), entryBefore);
+			entries.back() = entry;
+			push_heap(entries.begin(), entries.end(), entryBefore);
+		}
+	});
+
+    if(entries.size() == 0) {
+		ofLogError("ofxImageSequence::loadSequence") << "No image files found in " << folderToLoad;
+		return false;
+	}
+
+	sort(entries.begin(), entries.end(), entryBefore);
+
+	int selectedFirst, numFiles;
+	if(!selectFrames(entries.size(), selectedFirst, numFiles)){
+		ofLogError("ofxImageSequence::loadSequence") << "No image files in the frame range in " << folderToLoad;
+		return false;
+	}
+	entries.erase(entries.begin(), entries.begin() + selectedFirst);
+	entries.resize(MIN((int)entries.size(), (numFiles - 1) * loadStride + 1));
+
+	//numbers skipped or repeated between neighbours that share a name pattern, across the range before the stride thins it out
+	int numMissing = 0;
+	for(int i = 1; i < entries.size(); i++){
+		const ofxImageSequenceEntry& previous = entries[i-1];
+		const ofxImageSequenceEntry& entry = entries[i];
+		if(previous.number < 0 || previous.prefix != entry.prefix){
+			continue;
+		}
+		if(entry.number == previous.number){
+			if(duplicateFrameNumbers.size() == 0 || duplicateFrameNumbers.back() != entry.number){
+				duplicateFrameNumbers.push_back(entry.number);
+			}
+		}
+		else if(entry.number > previous.number + 1){
+			frameGaps.push_back(make_pair(previous.number + 1, entry.number - previous.number - 1));
+			numMissing += entry.number - previous.number - 1;
+		}
+	}
+	if(numMissing > 0){
+		ofLogWarning("ofxImageSequence::loadSequence") << numMissing << " frames missing in " << frameGaps.size() << " gaps in " << folderToLoad;
+	}
+	if(duplicateFrameNumbers.size() > 0){
+		ofLogWarning("ofxImageSequence::loadSequence") << duplicateFrameNumbers.size() << " frame numbers appear more than once in " << folderToLoad;
+	}
+
+	for(int i = 0; i < numFiles; i++){
+		entries[i] = entries[i * loadStride];
+	}
+	entries.resize(numFiles);
+
+	//when every name is the same pattern around the number only the numbers are kept
+	const ofxImageSequenceEntry& first = entries[0];
+	bool samePattern = true;
+	bool samePadding = true;
+	bool noPadding = true;
+	for(int i = 0; i < numFiles && samePattern; i++){
+		const ofxImageSequenceEntry& entry = entries[i];
+		samePattern = entry.number >= 0 && entry.prefix == first.prefix && entry.suffix == first.suffix;
+		samePadding = samePadding && entry.digits == first.digits;
+		noPadding = noPadding && entry.digits == countDigits(entry.number);
+	}
+
+	string folder = ofFilePath::addTrailingSlash(folderToLoad);
+	compactNames = samePattern && (samePadding || noPadding);
+	reserveFrames(numFiles);
+	if(compactNames){
+		namePrefix = folder + first.prefix;
+		nameSuffix = first.suffix;
+		nameDigits = samePadding ? first.digits : 0;
+		for(int i = 0; i < numFiles; i++){
+			addFrame(entries[i].number);
+		}
+	}
+	else{
+		for(int i = 0; i < numFiles; i++){
+			addFrame(folder + entries[i].name, entries[i].number);
+		}
+	}
+
+	if(useManifest){
+		writeManifest(folderModified);
+	}
+	return true;
+}
+
+bool ofxImageSequence::preloadManifestFilenames()
+{
+	string folder = ofFilePath::addTrailingSlash(folderToLoad);
+	compactNames = manifest.compactNames;
+	namePrefix = folder + manifest.namePrefix;
+	nameSuffix = manifest.nameSuffix;
+	nameDigits = manifest.nameDigits;
+	frameGaps = manifest.frameGaps;
+	duplicateFrameNumbers = manifest.duplicateFrameNumbers;
+	sourceFirst = manifest.rangeFirst;
+	sourceStride = manifest.stride;
+
+	int numFiles = manifest.frames.size();
+	reserveFrames(numFiles);
+	for(int i = 0; i < numFiles; i++){
+		ofxImageSequenceManifest::Frame& frame = manifest.frames[i];
+		if(compactNames){
+			addFrame(frame.number);
+		}
+		else{
+			addFrame(folder + frame.name, frame.number);
+		}
+		loadFailed[i] = frame.failed;
+
+		//a frame fixed in place doesn't touch the folder, only its own stats say it's worth trying again
+		uint64_t size, modified;
+		if(frame.failed && ofxImageSequenceManifest::getFileStats(getFramePath(i), size, modified) &&
+		   (size != frame.size || modified != frame.modified)){
+			frame.size = size;
+			frame.modified = modified;
+			frame.failed = false;
+			loadFailed[i] = false;
+			manifestDirty = true;
+		}
+	}
+
+	loadedFromManifest = true;
+	return true;
+}
+
+//records a freshly scanned folder. the first frame's size comes from its header, so this costs a stat per frame and no decoding
+void ofxImageSequence::writeManifest(uint64_t folderModified)
+{
+	string folder = ofFilePath::addTrailingSlash(folderToLoad);
+	manifest.clear();
+	manifest.folderModified = folderModified;
+	manifest.extension = extension;
+	manifest.maxFrames = maxFrames;
+	manifest.rangeFirst = loadRangeFirst;
+	manifest.rangeLast = loadRangeLast;
+	manifest.stride = loadStride;
+	manifest.compactNames = compactNames;
+	manifest.nameSuffix = nameSuffix;
+	manifest.nameDigits = nameDigits;
+	manifest.frameGaps = frameGaps;
+	manifest.duplicateFrameNumbers = duplicateFrameNumbers;
+	if(compactNames){
+		manifest.namePrefix = namePrefix.substr(folder.size());
+	}
+
+	int probedWidth, probedHeight, probedChannels;
+	if(readImageHeader(getFramePath(0), probedWidth, probedHeight, probedChannels)){
+		manifest.width = probedWidth;
+		manifest.height = probedHeight;
+		manifest.channels = probedChannels;
+	}
+
+	manifest.frames.resize(frameNumbers.size());
+	for(int i = 0; i < frameNumbers.size(); i++){
+		ofxImageSequenceManifest::Frame& frame = manifest.frames[i];
+		frame.number = frameNumbers[i];
+		frame.size = 0;
+		frame.modified = 0;
+		frame.failed = false;
+		ofxImageSequenceManifest::getFileStats(getFramePath(i), frame.size, frame.modified);
+		if(!compactNames){
+			frame.name = filenames[i].substr(folder.size());
+		}
+	}
+
+	manifest.save(ofxImageSequenceManifest::getPathForFolder(folderToLoad));
+}
+
+string ofxImageSequence::getFramePath(int imageIndex)
+{
+	if(!compactNames){
+		return filenames[imageIndex];
+	}
+	char number[16];
+	snprintf(number, sizeof(number), "%0*d", nameDigits, frameNumbers[imageIndex]);
+	return namePrefix + number + nameSuffix;
+}
+
+void ofxImageSequence::reserveFrames(int numFrames)
+{
+	if(!compactNames){
+		filenames.reserve(numFrames);
+	}
+	frameNumbers.reserve(numFrames);
+	sequence.reserve(numFrames);
+	sharedFrames.reserve(numFrames);
+	proxies.reserve(numFrames);
+	trimRects.reserve(numFrames);
+	deltaRects.reserve(numFrames);
+	compressedFrames.reserve(numFrames);
+	compressedPosition.reserve(numFrames);
+	deltaPatches.reserve(numFrames);
+	loadFailed.reserve(numFrames);
+	cachePosition.reserve(numFrames);
+}
+
+void ofxImageSequence::addFrame(const string& path, int number)
+{
+	filenames.push_back(path);
+	addFrame(number);
+}
+
+void ofxImageSequence::addFrame(int number)
+{
+	frameNumbers.push_back(number);
+	sequence.push_back(ofPixels());
+	sharedFrames.push_back(shared_ptr<ofPixels>());
+	proxies.push_back(ofPixels());
+	trimRects.push_back(ofRectangle());
+	deltaRects.push_back(ofRectangle());
+	compressedFrames.push_back(shared_ptr<CompressedFrame>());
+	compressedPosition.push_back(compressedOrder.end());
+	deltaPatches.push_back(false);
+	loadFailed.push_back(false);
+	cachePosition.push_back(cacheOrder.end());
+}
+
+bool ofxImageSequence::preloadPackedFilenames()
+{
+	if(!packedFile.open(folderToLoad)){
+		return false;
+	}
+
+	//frame numbers are positions in the packed file
+	int first, numFiles;
+	if(!selectFrames(packedFile.getNumFrames(), first, numFiles)) {
+		ofLogError("ofxImageSequence::loadSequence") << "No frames found in " << folderToLoad;
+		packedFile.close();
+		return false;
+	}
+
+	compactNames = true;
+	namePrefix = folderToLoad + "#";
+	reserveFrames(numFiles);
+	for(int i = 0; i < numFiles; i++){
+		addFrame(first + i * loadStride);
+	}
+	return true;
+}
+
+bool ofxImageSequence::preloadRawFilenames()
+{
+	if(!rawFile.open(folderToLoad)){
+		return false;
+	}
+
+	//frame numbers are positions in the raw file
+	int first, numFiles;
+	if(!selectFrames(rawFile.getNumFrames(), first, numFiles)) {
+		ofLogError("ofxImageSequence::loadSequence") << "No frames found in " << folderToLoad;
+		rawFile.close();
+		return false;
+	}
+
+	//every frame is a view into the mapping, nothing is decoded or copied and the cache never evicts them
+	compactNames = true;
+	namePrefix = folderToLoad + "#";
+	reserveFrames(numFiles);
+	for(int i = 0; i < numFiles; i++){
+		int frame = first + i * loadStride;
+		addFrame(frame);
+		if(rawFile.isFrameValid(frame)){
+			sequence[i].setFromExternalPixels(rawFile.getFrameData(frame), rawFile.getWidth(), rawFile.getHeight(), rawFile.getPixelFormat());
+		}
+		else{
+			loadFailed[i] = true;
+		}
+	}
+	return true;
+}
+
+bool ofxImageSequence::saveRawSequence(string rawPath)
+{
+	if(sequence.size() == 0 || rawFile.isOpen()){
+		ofLogError("ofxImageSequence::saveRawSequence") << "Need a sequence loaded from image files to convert";
+		return false;
+	}
+	if(alphaTrim){
+		ofLogError("ofxImageSequence::saveRawSequence") << "Raw frames are all the same size, disable alpha trim before converting";
+		return false;
+	}
+
+	DecodedFrame firstFrame;
+	if(!decodeFrame(0, firstFrame)){
+		return false;
+	}
+
+	ofxImageSequenceRawFile writer;
+	//the format goes in the header too, a BGRA layout would otherwise come back as RGBA with red and blue swapped
+	if(!writer.create(rawPath, sequence.size(), firstFrame.pixels.getWidth(), firstFrame.pixels.getHeight(), firstFrame.pixels.getNumChannels(), firstFrame.pixels.getPixelFormat())){
+		return false;
+	}
+
+	writer.appendFrame(firstFrame.pixels);
+	for(int i = 1; i < sequence.size(); i++){
+		DecodedFrame frame;
+		decodeFrame(i, frame);
+		writer.appendFrame(frame.pixels);
+	}
+	return writer.finish();
+}
+
+bool ofxImageSequence::savePackedSequence(string packedPath)
+{
+	if(sequence.size() == 0 || packedFile.isOpen() || rawFile.isOpen()){
+		ofLogError("ofxImageSequence::savePackedSequence") << "Need a sequence loaded from image files to pack";
+		return false;
+	}
+
+	vector<string> paths;
+	paths.reserve(sequence.size());
+	for(int i = 0; i < sequence.size(); i++){
+		paths.push_back(getFramePath(i));
+	}
+	return ofxImageSequencePackedFile::write(paths, packedPath);
+}
+
+//set to limit the number of frames. negative means no limit
+void ofxImageSequence::setMaxFrames(int newMaxFrames)
+{
+	maxFrames = MAX(newMaxFrames, 0);
+	if(loaded){
+		ofLogError("ofxImageSequence::setMaxFrames") << "Max frames must be called before load";
+	}
+}
+
+void ofxImageSequence::setFrameRange(int firstFrame, int lastFrame)
+{
+	if(loaded){
+		ofLogError("ofxImageSequence::setFrameRange") << "Frame range must be set before load";
+	}
+	frameRangeFirst = MAX(firstFrame, 0);
+	frameRangeLast = lastFrame < 0 ? -1 : MAX(lastFrame, frameRangeFirst);
+}
+
+void ofxImageSequence::setFrameStride(int stride)
+{
+	if(loaded){
+		ofLogError("ofxImageSequence::setFrameStride") << "Frame stride must be set before load";
+	}
+	frameStride = MAX(stride, 1);
+}
+
+//the range and stride this load picks frames with, which the loadSequence overloads can give without touching setFrameRange and setFrameStride
+void ofxImageSequence::setLoadSelection(int firstFrame, int lastFrame, int stride)
+{
+	loadRangeFirst = MAX(firstFrame, 0);
+	loadRangeLast = lastFrame < 0 ? -1 : MAX(lastFrame, loadRangeFirst);
+	loadStride = MAX(stride, 1);
+}
+
+int ofxImageSequence::getFrameRangeFirst()
+{
+	return frameRangeFirst;
+}
+
+int ofxImageSequence::getFrameRangeLast()
+{
+	return frameRangeLast;
+}
+
+int ofxImageSequence::getFrameStride()
+{
+	return frameStride;
+}
+
+//picks frames out of numSource with the range, stride and frame limit, returns false if none are left
+bool ofxImageSequence::selectFrames(int numSource, int& first, int& count)
+{
+	first = loadRangeFirst;
+	int last = loadRangeLast >= 0 ? MIN(loadRangeLast, numSource - 1) : numSource - 1;
+	count = first <= last ? (last - first) / loadStride + 1 : 0;
+	if(maxFrames > 0){
+		count = MIN(count, maxFrames);
+	}
+	sourceFirst = first;
+	sourceStride = loadStride;
+	return count > 0;
+}
+
+void ofxImageSequence::setPixelLayout(PixelLayout layout, bool premultiply)
+{
+	pixelLayout = layout;
+	premultiplied = premultiply;
+	if(loaded){
+		ofLogError("ofxImageSequence::setPixelLayout") << "Pixel layout must be set before load";
+	}
+}
+
+ofxImageSequence::PixelLayout ofxImageSequence::getPixelLayout()
+{
+	return pixelLayout;
+}
+
+bool ofxImageSequence::isPremultiplied()
+{
+	return premultiplied;
+}
+
+void ofxImageSequence::enableAlphaTrim(bool enable)
+{
+	alphaTrim = enable;
+	if(loaded){
+		ofLogError("ofxImageSequence::enableAlphaTrim") << "Alpha trim must be enabled before load";
+	}
+}
+
+bool ofxImageSequence::isAlphaTrimEnabled()
+{
+	return alphaTrim;
+}
+
+ofRectangle ofxImageSequence::getTrimRect()
+{
+	return getTrimRectForFrame(lastFrameLoaded);
+}
+
+ofRectangle ofxImageSequence::getTrimRectForFrame(int index)
+{
+	ofScopedLock lock(loadMutex);
+	if(index >= 0 && index < trimRects.size() && trimRects[index].width > 0){
+		return trimRects[index];
+	}
+	return ofRectangle(0, 0, width, height);
+}
+
+void ofxImageSequence::enableDeltaFrames(int keyframeInterval)
+{
+	deltaInterval = MAX(keyframeInterval, 0);
+	if(loaded){
+		ofLogError("ofxImageSequence::enableDeltaFrames") << "Delta frames must be enabled before load";
+	}
+}
+
+int ofxImageSequence::getDeltaKeyframeInterval()
+{
+	return deltaInterval;
+}
+
+ofRectangle ofxImageSequence::getDirtyRect()
+{
+	ofScopedLock lock(loadMutex);
+	return lastDirtyRect;
+}
+
+ofRectangle ofxImageSequence::getDirtyRectForFrame(int index)
+{
+	ofScopedLock lock(loadMutex);
+	if(usesDeltaFrames() && index >= 0 && index < sequence.size() && sequence[index].isAllocated()){
+		return deltaRects[index];
+	}
+	return ofRectangle(0, 0, width, height);
+}
+
+void ofxImageSequence::enableManifest(bool enable)
+{
+	useManifest = enable;
+	if(loaded){
+		ofLogError("ofxImageSequence::enableManifest") << "Manifest must be enabled before load";
+	}
+}
+
+bool ofxImageSequence::isLoadedFromManifest()
+{
+	return loadedFromManifest;
+}
+
+void ofxImageSequence::setExtension(string ext)
+{
+	extension = ext;
+}
+
+void ofxImageSequence::enableThreadedLoad(bool enable){
+
+	if(loaded){
+		ofLogError("ofxImageSequence::enableThreadedLoad") << "Need to enable threaded loading before calling load";
+	}
+	useThread = enable;
+}
+
+void ofxImageSequence::enableSharedCache(bool enable)
+{
+	if(loaded){
+		ofLogError("ofxImageSequence::enableSharedCache") << "Need to enable the shared cache before calling load";
+	}
+	useSharedCache = enable;
+}
+
+void ofxImageSequence::enableLazyOpen(bool enable)
+{
+	if(loaded){
+		ofLogError("ofxImageSequence::enableLazyOpen") << "Need to enable lazy open before calling load";
+	}
+	lazyOpen = enable;
+}
+
+void ofxImageSequence::setNumLoadThreads(int numThreads)
+{
+	if(isLoading()){
+		ofLogError("ofxImageSequence::setNumLoadThreads") << "Can't change the number of load threads while loading";
+		return;
+	}
+	numLoadThreads = numThreads;
+}
+
+void ofxImageSequence::setLoadThrottle(LoadThrottle mode, float amount)
+{
+	if(mode == THROTTLE_FRAMES_PER_SECOND && amount <= 0){
+		ofLogError("ofxImageSequence::setLoadThrottle") << "Frames per second budget must be greater than zero, disabling throttle";
+		mode = THROTTLE_NONE;
+	}
+	if(mode == THROTTLE_DUTY_CYCLE && (amount <= 0 || amount > 1.0)){
+		ofLogError("ofxImageSequence::setLoadThrottle") << "Duty cycle must be between 0 and 1, clamping";
+		amount = ofClamp(amount, 0.01, 1.0);
+	}
+
+	ofScopedLock lock(loadMutex);
+	loadThrottle = mode;
+	loadThrottleAmount = amount;
+	nextThrottleSlot = 0;
+	lock.unlock();
+	wakeScheduler();
+}
+
+ofxImageSequence::LoadThrottle ofxImageSequence::getLoadThrottle()
+{
+	return loadThrottle;
+}
+
+void ofxImageSequence::setCacheBudgetBytes(uint64_t bytes)
+{
+	ofScopedLock lock(loadMutex);
+	cacheBudgetBytes = bytes;
+	evictFrames(-1);
+}
+
+void ofxImageSequence::setCacheMaxFrames(int frames)
+{
+	ofScopedLock lock(loadMutex);
+	cacheMaxFrames = MAX(frames, 0);
+	evictFrames(-1);
+}
+
+uint64_t ofxImageSequence::getCacheResidentBytes()
+{
+	ofScopedLock lock(loadMutex);
+	return cacheResidentBytes;
+}
+
+int ofxImageSequence::getCacheResidentFrames()
+{
+	ofScopedLock lock(loadMutex);
+	return cacheOrder.size();
+}
+
+uint64_t ofxImageSequence::getCacheHits()
+{
+	ofScopedLock lock(loadMutex);
+	return cacheHits;
+}
+
+uint64_t ofxImageSequence::getCacheMisses()
+{
+	ofScopedLock lock(loadMutex);
+	return cacheMisses;
+}
+
+uint64_t ofxImageSequence::getCacheEvictions()
+{
+	ofScopedLock lock(loadMutex);
+	return cacheEvictions;
+}
+
+void ofxImageSequence::resetCacheStats()
+{
+	ofScopedLock lock(loadMutex);
+	cacheHits = 0;
+	cacheMisses = 0;
+	cacheEvictions = 0;
+	compressedHits = 0;
+}
+
+void ofxImageSequence::setCompressedCacheBudgetBytes(uint64_t bytes)
+{
+	ofScopedLock lock(loadMutex);
+	compressedBudgetBytes = bytes;
+	evictCompressedFrames(-1);
+}
+
+uint64_t ofxImageSequence::getCompressedCacheBudgetBytes()
+{
+	ofScopedLock lock(loadMutex);
+	return compressedBudgetBytes;
+}
+
+uint64_t ofxImageSequence::getCompressedCacheResidentBytes()
+{
+	ofScopedLock lock(loadMutex);
+	return compressedResidentBytes;
+}
+
+int ofxImageSequence::getCompressedCacheFrames()
+{
+	ofScopedLock lock(loadMutex);
+	return compressedOrder.size();
+}
+
+uint64_t ofxImageSequence::getCompressedCacheHits()
+{
+	ofScopedLock lock(loadMutex);
+	return compressedHits;
+}
+
+float ofxImageSequence::getCompressionRatio()
+{
+	ofScopedLock lock(loadMutex);
+	if(compressedResidentBytes == 0){
+		return 1.0;
+	}
+	return (double)compressedSourceBytes / compressedResidentBytes;
+}
+
+//call with loadMutex held. also full when frames don't go through the tier at all: raw files are
+//already a straight copy and frames from the shared cache are held once for every sequence
+bool ofxImageSequence::isCompressedCacheFull()
+{
+	if(compressedBudgetBytes == 0 || rawFile.isOpen() || (useSharedCache && !alphaTrim && !usesDeltaFrames())){
+		return true;
+	}
+	if(compressedOrder.size() > 0){
+		uint64_t averageFrameBytes = compressedResidentBytes / compressedOrder.size();
+		return compressedResidentBytes + averageFrameBytes > compressedBudgetBytes;
+	}
+	return false;
+}
+
+//call with loadMutex held. drops least recently used compressed frames until the tier is within its budget, never dropping keepIndex
+void ofxImageSequence::evictCompressedFrames(int keepIndex)
+{
+	list<int>::iterator it = compressedOrder.end();
+	while(it != compressedOrder.begin() && compressedResidentBytes > compressedBudgetBytes){
+		it--;
+		int victim = *it;
+		if(victim == keepIndex){
+			continue;
+		}
+		it++;
+		compressedResidentBytes -= compressedFrames[victim]->data.size();
+		compressedSourceBytes -= compressedFrames[victim]->sourceBytes;
+		compressedFrames[victim].reset();
+		compressedOrder.erase(compressedPosition[victim]);
+		compressedPosition[victim] = compressedOrder.end();
+	}
+}
+
+//call without loadMutex held. keeps a compressed copy of a freshly decoded frame, on whichever thread decoded it
+void ofxImageSequence::compressFrame(int imageIndex, const ofPixels& pixels)
+{
+	{
+		ofScopedLock lock(loadMutex);
+		if(compressedBudgetBytes == 0 || compressedFrames[imageIndex]){
+			return;
+		}
+	}
+
+	shared_ptr<CompressedFrame> compressed(new CompressedFrame());
+	compressed->width = pixels.getWidth();
+	compressed->height = pixels.getHeight();
+	compressed->format = pixels.getPixelFormat();
+	compressed->sourceBytes = pixels.getTotalBytes();
+	compressed->isCompressed = ofxImageSequenceCodec::compress(pixels.getData(), pixels.getTotalBytes(), compressed->data) > 0;
+	if(!compressed->isCompressed){
+		//noise doesn't compress, a plain copy is still far quicker to get back than a decode
+		compressed->data.assign(pixels.getData(), pixels.getData() + pixels.getTotalBytes());
+	}
+
+	ofScopedLock lock(loadMutex);
+	if(compressedFrames[imageIndex] || compressedBudgetBytes == 0){
+		return;
+	}
+	compressedFrames[imageIndex] = compressed;
+	compressedResidentBytes += compressed->data.size();
+	compressedSourceBytes += compressed->sourceBytes;
+	compressedOrder.push_front(imageIndex);
+	compressedPosition[imageIndex] = compressedOrder.begin();
+	evictCompressedFrames(imageIndex);
+}
+
+//call without loadMutex held. copies a frame decoded off the scheduler's workers, eg by a blocking loadFrame, for a
+//preload job to compress. at most a pool's worth wait so the copies come from and go back to the pixel pool
+void ofxImageSequence::deferCompress(int imageIndex, const ofPixels& pixels)
+{
+	{
+		ofScopedLock lock(loadMutex);
+		if(compressedBudgetBytes == 0 || compressedFrames[imageIndex] || framesToCompress.count(imageIndex) > 0 ||
+		   framesToCompress.size() >= MAX(pixelPool.getCapacity(), 1)){
+			return;
+		}
+	}
+
+	ofPixels copy;
+	pixelPool.acquire(copy);
+	copy.allocate(pixels.getWidth(), pixels.getHeight(), pixels.getPixelFormat());
+	memcpy(copy.getData(), pixels.getData(), pixels.getTotalBytes());
+
+	{
+		ofScopedLock lock(loadMutex);
+		if(framesToCompress.count(imageIndex) == 0){
+			framesToCompress[imageIndex].swap(copy);
+		}
+	}
+	pixelPool.release(copy);
+	scheduleJobs();
+}
+
+//compresses a frame deferCompress left, returns false if there are none
+bool ofxImageSequence::compressNextFrame()
+{
+	int index;
+	ofPixels pixels;
+	{
+		ofScopedLock lock(loadMutex);
+		if(framesToCompress.empty()){
+			return false;
+		}
+		map<int, ofPixels>::iterator it = framesToCompress.begin();
+		index = it->first;
+		pixels.swap(it->second);
+		framesToCompress.erase(it);
+	}
+	compressFrame(index, pixels);
+	pixelPool.release(pixels);
+	return true;
+}
+
+//call without loadMutex held. fills pixels from the compressed tier, returns false if the frame isn't in it
+bool ofxImageSequence::decompressFrame(int imageIndex, ofPixels& pixels)
+{
+	shared_ptr<CompressedFrame> compressed;
+	{
+		ofScopedLock lock(loadMutex);
+		compressed = compressedFrames[imageIndex];
+		if(!compressed){
+			return false;
+		}
+		compressedOrder.splice(compressedOrder.begin(), compressedOrder, compressedPosition[imageIndex]);
+		compressedHits++;
+	}
+
+	//the frame may be evicted from the tier meanwhile, our reference keeps its data alive until we're done
+	uint64_t decodeStart = ofGetElapsedTimeMicros();
+	pixels.allocate(compressed->width, compressed->height, compressed->format);
+	if(!compressed->isCompressed){
+		memcpy(pixels.getData(), &compressed->data[0], compressed->data.size());
+	}
+	else if(!ofxImageSequenceCodec::decompress(&compressed->data[0], compressed->data.size(), pixels.getData(), pixels.getTotalBytes())){
+		ofLogError("ofxImageSequence::decompressFrame") << "Compressed frame " << imageIndex << " is corrupt, decoding it again";
+		return false;
+	}
+	stats.addSample(ofxImageSequenceStats::STAGE_DECODE, ofGetElapsedTimeMicros() - decodeStart);
+	return true;
+}
+
+//call with loadMutex held
+bool ofxImageSequence::isCacheFull()
+{
+	if(cacheMaxFrames > 0 && cacheOrder.size() >= cacheMaxFrames){
+		return true;
+	}
+	if(cacheBudgetBytes > 0 && cacheOrder.size() > 0){
+		uint64_t averageFrameBytes = cacheResidentBytes / cacheOrder.size();
+		return cacheResidentBytes + averageFrameBytes > cacheBudgetBytes;
+	}
+	return false;
+}
+
+//call with loadMutex held. evicts least recently used frames until the cache is within its limits, never evicting keepIndex
+void ofxImageSequence::evictFrames(int keepIndex)
+{
+	list<int>::iterator it = cacheOrder.end();
+	while(it != cacheOrder.begin()){
+		bool overFrames = cacheMaxFrames > 0 && cacheOrder.size() > cacheMaxFrames;
+		bool overBytes  = cacheBudgetBytes > 0 && cacheResidentBytes > cacheBudgetBytes;
+		if(!overFrames && !overBytes){
+			return;
+		}
+
+		it--;
+		int victim = *it;
+		//the frame on screen stays put too, getPixels hands out references to it
+		if(victim == keepIndex || victim == lastFrameLoaded){
+			continue;
+		}
+
+		if(usesDeltaFrames()){
+			//a patch is useless without the frames before it, so delta frames go a whole group at a time
+			int first = getDeltaGroupStart(victim);
+			int last = MIN(first + deltaInterval, (int)sequence.size());
+			bool inUse = false;
+			for(int i = first; i < last && !inUse; i++){
+				inUse = i == keepIndex || i == lastFrameLoaded || framesDecoding.count(i) > 0;
+			}
+			if(inUse){
+				continue;
+			}
+			for(int i = first; i < last; i++){
+				if(sequence[i].isAllocated()){
+					evictFrame(i);
+				}
+			}
+			it = cacheOrder.end();
+			continue;
+		}
+
+		it++;
+		evictFrame(victim);
+	}
+}
+
+//call with loadMutex held. drops a resident frame, handing its buffer to the pixel pool for the next decode
+void ofxImageSequence::evictFrame(int imageIndex)
+{
+	cacheResidentBytes -= sequence[imageIndex].getTotalBytes();
+	recycleFrame(sequence[imageIndex], sharedFrames[imageIndex], deltaPatches[imageIndex]);
+	sharedFrames[imageIndex].reset();
+	cacheOrder.erase(cachePosition[imageIndex]);
+	cachePosition[imageIndex] = cacheOrder.end();
+	cacheEvictions++;
+}
+
+void ofxImageSequence::recycleFrame(ofPixels& pixels, const shared_ptr<ofPixels>& shared, bool patch)
+{
+	//views into the shared cache or a raw file don't own their pixels so there's nothing to recycle, and
+	//delta patches, trimmed frames or anything else not the size of a whole frame would only crowd out
+	//buffers the next decode can use. until the size is known everything but patches is pooled
+	bool wrongSize = width > 0 && pixels.getTotalBytes() != (size_t)width * height * numChannels;
+	if(shared || rawFile.isOpen() || patch || wrongSize){
+		pixels.clear();
+	}
+	else{
+		pixelPool.release(pixels);
+	}
+}
+
+//call with loadMutex held. evicts every frame outside the streaming window around the playhead
+void ofxImageSequence::trimStreamingWindow(int index)
+{
+	//delta groups can't be split at the window's edges, the frame limit streaming sets still bounds the cache
+	if(usesDeltaFrames()){
+		return;
+	}
+
+	int total = sequence.size();
+	int ahead = streamingAhead;
+	int behind = streamingBehind;
+	if(playheadScrubbing){
+		ahead = behind = MAX(streamingAhead, streamingBehind);
+	}
+	bool forward = playheadStep >= 0;
+
+	list<int>::iterator it = cacheOrder.begin();
+	while(it != cacheOrder.end()){
+		int frame = *it;
+		it++;
+		//distance in the direction of playback, wrapping around the end of the sequence
+		int distance = forward ? frame - index : index - frame;
+		distance = ((distance % total) + total) % total;
+		bool inWindow = distance <= ahead || total - distance <= behind;
+		if(!inWindow && frame != lastFrameLoaded){
+			evictFrame(frame);
+		}
+	}
+}
+
+//call with loadMutex held. marks a resident frame as most recently used
+void ofxImageSequence::touchFrame(int imageIndex)
+{
+	if(cachePosition[imageIndex] != cacheOrder.end()){
+		cacheOrder.splice(cacheOrder.begin(), cacheOrder, cachePosition[imageIndex]);
+	}
+}
+
+void ofxImageSequence::enableAsyncFrames(bool enable)
+{
+	if(enable == asyncFrames){
+		return;
+	}
+	asyncFrames = enable;
+	updateListener();
+}
+
+//frames decoded in the background are swapped in from the update event when async frames or proxies are on
+void ofxImageSequence::updateListener()
+{
+	bool listen = asyncFrames || proxyScale != PROXY_NONE;
+	if(listen && !listeningToUpdate){
+		ofAddListener(ofEvents().update, this, &ofxImageSequence::updateAsyncFrame);
+	}
+	else if(!listen && listeningToUpdate){
+		ofRemoveListener(ofEvents().update, this, &ofxImageSequence::updateAsyncFrame);
+	}
+	listeningToUpdate = listen;
+}
+
+void ofxImageSequence::enableProxies(ProxyScale scale, bool saveToDisk)
+{
+	{
+		//a build already running finds the scale changed and throws its proxy away
+		ofScopedLock lock(loadMutex);
+		buildingProxies = false;
+		if(scale != proxyScale){
+			for(int i = 0; i < proxies.size(); i++){
+				proxies[i].clear();
+			}
+		}
+		proxyScale = scale;
+		proxiesOnDisk = saveToDisk;
+	}
+	updateListener();
+}
+
+ofxImageSequence::ProxyScale ofxImageSequence::getProxyScale()
+{
+	return proxyScale;
+}
+
+void ofxImageSequence::buildProxies()
+{
+	if(proxyScale == PROXY_NONE || !loaded){
+		ofLogError("ofxImageSequence::buildProxies") << "Enable proxies and load a sequence before building proxies";
+		return;
+	}
+	//shares the sequence's preload workers, after any frames still preloading
+	{
+		ofScopedLock lock(loadMutex);
+		if(buildingProxies){
+			return;
+		}
+		buildingProxies = true;
+		nextProxyFrame = 0;
+	}
+	scheduleJobs();
+}
+
+//call with loadMutex held
+bool ofxImageSequence::hasProxyFrames()
+{
+	return buildingProxies && nextProxyFrame < sequence.size();
+}
+
+//builds the next proxy buildProxies still wants, returns false once there are none left
+bool ofxImageSequence::buildNextProxy()
+{
+	loadMutex.lock();
+	int index = -1;
+	while(hasProxyFrames()){
+		int candidate = nextProxyFrame++;
+		if(!proxies[candidate].isAllocated() && !loadFailed[candidate]){
+			index = candidate;
+			break;
+		}
+	}
+	if(!hasProxyFrames()){
+		buildingProxies = false;
+	}
+	loadMutex.unlock();
+
+	if(index < 0){
+		return false;
+	}
+	buildProxy(index);
+	return true;
+}
+
+bool ofxImageSequence::isShowingProxy()
+{
+	return showingProxy;
+}
+
+string ofxImageSequence::getProxyPath(int imageIndex)
+{
+	string extension = numChannels == 4 || numChannels == 2 ? ".png" : ".jpg";
+	string proxyFolder = ".proxy" + ofToString((int)proxyScale) + getPixelLayoutSuffix();
+	if(packedFile.isOpen() || rawFile.isOpen()){
+		return folderToLoad + proxyFolder + "/" + ofToString(frameNumbers[imageIndex]) + extension;
+	}
+	string path = getFramePath(imageIndex);
+	return ofFilePath::join(ofFilePath::getEnclosingDirectory(path, false), proxyFolder) + "/" + ofFilePath::getBaseName(path) + extension;
+}
+
+//call without loadMutex held. fills in a frame's proxy from disk if it was saved there, otherwise from the full frame
+void ofxImageSequence::buildProxy(int imageIndex)
+{
+	//a saved proxy of a trimmed frame is no use until the frame's been decoded once and its offset is known
+	bool trimKnown;
+	ProxyScale scale;
+	{
+		ofScopedLock lock(loadMutex);
+		if(proxyScale == PROXY_NONE || proxies[imageIndex].isAllocated() || loadFailed[imageIndex]){
+			return;
+		}
+		trimKnown = !alphaTrim || trimRects[imageIndex].width > 0;
+		scale = proxyScale;
+	}
+
+	ofPixels proxy;
+	DecodedFrame frame;
+	string proxyPath = proxiesOnDisk && trimKnown ? getProxyPath(imageIndex) : "";
+	if(proxyPath == "" || !ofFile(proxyPath).exists() || !ofLoadImage(proxy, proxyPath)){
+		if(!decodeFrame(imageIndex, frame)){
+			return;
+		}
+		makeProxy(imageIndex, frame.pixels, proxy);
+	}
+	else if(pixelLayout == PIXELS_BGRA && proxy.getNumChannels() == 4){
+		//saving and loading swap red and blue both ways so the bytes are already in order, only the label is lost
+		ofPixels loaded;
+		loaded.swap(proxy);
+		proxy.setFromPixels(loaded.getData(), loaded.getWidth(), loaded.getHeight(), OF_PIXELS_BGRA);
+	}
+
+	ofScopedLock lock(loadMutex);
+	if(frame.untrimmedWidth > 0){
+		trimRects[imageIndex] = frame.trim;
+	}
+	if(!proxies[imageIndex].isAllocated() && proxyScale == scale){
+		proxies[imageIndex].swap(proxy);
+	}
+}
+
+void ofxImageSequence::makeProxy(int imageIndex, const ofPixels& pixels, ofPixels& proxy)
+{
+	downsamplePixels(pixels, proxy, proxyScale);
+	if(proxiesOnDisk){
+		string proxyPath = getProxyPath(imageIndex);
+		ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(proxyPath, false), false, true);
+		ofSaveImage(proxy, proxyPath);
+	}
+}
+
+bool ofxImageSequence::uploadProxy(int imageIndex)
+{
+	{
+		//proxies are only ever added while loaded, so the reference holds without the lock
+		ofScopedLock lock(loadMutex);
+		if(!proxies[imageIndex].isAllocated()){
+			return false;
+		}
+		lastDirtyRect.set(0, 0, proxies[imageIndex].getWidth(), proxies[imageIndex].getHeight());
+		lastFrameLoaded = imageIndex;
+		showingProxy = true;
+	}
+
+	if(useTexture){
+		texture.loadData(proxies[imageIndex]);
+	}
+	return true;
+}
+
+bool ofxImageSequence::isAsyncFramesEnabled()
+{
+	return asyncFrames;
+}
+
+bool ofxImageSequence::isFrameExact()
+{
+	return lastFrameLoaded == currentFrame && !showingProxy;
+}
+
+int ofxImageSequence::getDisplayedFrame()
+{
+	return lastFrameLoaded;
+}
+
+void ofxImageSequence::enablePrefetch(bool enable)
+{
+	prefetchEnabled = enable;
+}
+
+bool ofxImageSequence::isPrefetchEnabled()
+{
+	return prefetchEnabled;
+}
+
+void ofxImageSequence::setPrefetchWindow(int frames)
+{
+	loadMutex.lock();
+	prefetchWindow = MAX(frames, 0);
+	loadMutex.unlock();
+	wakeScheduler();
+}
+
+int ofxImageSequence::getPrefetchWindow()
+{
+	return prefetchWindow;
+}
+
+//call with loadMutex held. infers playback direction, speed and mode from successive playhead positions
+void ofxImageSequence::notePlayhead(int index)
+{
+	int total = sequence.size();
+	if(playheadHistory.size() > 0 && total > 1){
+		int previous = playheadHistory.back();
+		int step = index - previous;
+		bool wrapped = false;
+		if(abs(step) > total / 2){
+			//looping playback crossing the end of the sequence
+			step += step > 0 ? -total : total;
+			wrapped = true;
+		}
+
+		if(step != 0){
+			bool reversed = playheadStep != 0 && (step > 0) != (playheadStep > 0);
+			bool atBoundary = previous + step < 0 || previous + step >= total || previous < abs(step) || previous >= total - abs(step);
+			if(wrapped){
+				playheadPingPong = false;
+				playheadScrubbing = abs(step) > prefetchWindow;
+			}
+			else if(reversed){
+				//turning around at either end is ping-pong, anywhere else is the user scrubbing
+				playheadPingPong = atBoundary;
+				playheadScrubbing = !atBoundary;
+			}
+			else{
+				playheadScrubbing = abs(step) > prefetchWindow || (playheadScrubbing && step != playheadStep);
+			}
+			playheadStep = step;
+		}
+	}
+
+	playheadHistory.push_back(index);
+	if(playheadHistory.size() > 4){
+		playheadHistory.pop_front();
+	}
+}
+
+//call with loadMutex held. lists the frames expected to be asked for next, nearest first
+void ofxImageSequence::getPrefetchFrames(vector<int>& frames)
+{
+	frames.clear();
+	if(!prefetchEnabled || playheadHistory.size() == 0 || sequence.size() == 0){
+		return;
+	}
+	int total = sequence.size();
+
+	int current = playheadHistory.back();
+	if(playheadScrubbing || playheadStep == 0){
+		for(int i = 1; i <= prefetchWindow; i++){
+			if(current + i < total){
+				frames.push_back(current + i);
+			}
+			if(current - i >= 0){
+				frames.push_back(current - i);
+			}
+		}
+		return;
+	}
+
+	int frame = current;
+	int step = playheadStep;
+	for(int i = 0; i < prefetchWindow; i++){
+		frame += step;
+		if(playheadPingPong){
+			if(frame >= total){
+				frame = 2 * (total - 1) - frame;
+				step = -step;
+			}
+			if(frame < 0){
+				frame = -frame;
+				step = -step;
+			}
+			frame = ofClamp(frame, 0, total - 1);
+		}
+		else{
+			frame = ((frame % total) + total) % total;
+		}
+		frames.push_back(frame);
+	}
+}
+
+//call with loadMutex held. claims a frame for decoding, returns false if it is already resident, failed or being decoded
+bool ofxImageSequence::beginDecode(int imageIndex)
+{
+	if(sequence[imageIndex].isAllocated() || loadFailed[imageIndex] || framesDecoding.count(imageIndex) > 0){
+		return false;
+	}
+
+	//delta frames are patches on the frame before, so their whole group is decoded in one go
+	if(usesDeltaFrames()){
+		int first = getDeltaGroupStart(imageIndex);
+		int last = MIN(first + deltaInterval, (int)sequence.size());
+		for(int i = first; i < last; i++){
+			if(framesDecoding.count(i) > 0){
+				return false;
+			}
+		}
+		for(int i = first; i < last; i++){
+			if(!sequence[i].isAllocated() && !loadFailed[i]){
+				framesDecoding.insert(i);
+			}
+		}
+		return true;
+	}
+
+	framesDecoding.insert(imageIndex);
+	return true;
+}
+
+//call without loadMutex held, once beginDecode has claimed the frame
+void ofxImageSequence::decodeAndStoreFrame(int imageIndex)
+{
+	if(usesDeltaFrames()){
+		decodeDeltaGroup(imageIndex);
+		return;
+	}
+	DecodedFrame frame;
+	storeFrame(imageIndex, frame, decodeFrame(imageIndex, frame));
+}
+
+//decodes every frame in a group in order, keeping the first whole and only what changed from the frame before for the rest
+void ofxImageSequence::decodeDeltaGroup(int imageIndex)
+{
+	int first = getDeltaGroupStart(imageIndex);
+	int last = MIN(first + deltaInterval, (int)sequence.size());
+	ofPixels previous;
+	for(int i = first; i < last; i++){
+		DecodedFrame frame;
+		bool success = decodeFrame(i, frame);
+		bool comparable = success && previous.isAllocated() &&
+			previous.getWidth() == frame.pixels.getWidth() &&
+			previous.getHeight() == frame.pixels.getHeight() &&
+			previous.getPixelFormat() == frame.pixels.getPixelFormat();
+
+		if(comparable){
+			int x, y, w, h;
+			if(ofxImageSequencePixelOps::getDifferenceBounds(previous, frame.pixels, x, y, w, h)){
+				frame.dirty.set(x, y, w, h);
+				frame.pixels.cropTo(frame.patch, x, y, w, h);
+			}
+			else{
+				//identical, a single pixel keeps the frame resident and the empty dirty rect says there's nothing to upload
+				frame.pixels.cropTo(frame.patch, 0, 0, 1, 1);
+			}
+			storeFrame(i, frame, true);
+			previous.swap(frame.pixels);
+			pixelPool.release(frame.pixels);
+			continue;
+		}
+
+		//the first frame, or one after a failure or a change of size, is kept whole
+		frame.dirty.set(0, 0, frame.pixels.getWidth(), frame.pixels.getHeight());
+		if(success && i + 1 < last){
+			previous = frame.pixels;
+		}
+		else{
+			pixelPool.release(previous);
+		}
+		storeFrame(i, frame, success);
+	}
+	pixelPool.release(previous);
+}
+
+int ofxImageSequence::getDeltaGroupStart(int imageIndex)
+{
+	return imageIndex - imageIndex % deltaInterval;
+}
+
+bool ofxImageSequence::usesDeltaFrames()
+{
+	//raw frames are views into the file, there's nothing to save by patching them
+	return deltaInterval > 1 && !rawFile.isOpen();
+}
+
+//call with loadMutex held
+bool ofxImageSequence::canDecode(int imageIndex)
+{
+	return !sequence[imageIndex].isAllocated() && !loadFailed[imageIndex] && framesDecoding.count(imageIndex) == 0;
+}
+
+//call without loadMutex held. registers with the scheduler the first time there's something to decode
+void ofxImageSequence::scheduleJobs()
+{
+	if(jobs == NULL){
+		jobs = new ofxImageSequenceJobs(this);
+		ofxImageSequenceScheduler::get().addSource(jobs);
+	}
+	ofxImageSequenceScheduler::get().wake();
+}
+
+//call without loadMutex held
+void ofxImageSequence::wakeScheduler()
+{
+	if(jobs != NULL){
+		ofxImageSequenceScheduler::get().wake();
+	}
+}
+
+bool ofxImageSequence::hasScheduledJob(ofxImageSequenceScheduler::Priority priority)
+{
+	ofScopedLock lock(loadMutex);
+	if(priority == ofxImageSequenceScheduler::PRIORITY_VISIBLE){
+		return requestedFrame >= 0 && requestedFrame < sequence.size() && canDecode(requestedFrame);
+	}
+	if(priority == ofxImageSequenceScheduler::PRIORITY_PREFETCH){
+		vector<int> frames;
+		getPrefetchFrames(frames);
+		for(int i = 0; i < frames.size(); i++){
+			if(canDecode(frames[i])){
+				return true;
+			}
+		}
+		return false;
+	}
+	if(threadLoader != NULL && !threadLoader->listed){
+		//nothing else may touch the frame lists while a worker fills them in
+		return !threadLoader->listing && !threadLoader->cancelLoading;
+	}
+	return (preloading && hasPreloadFrames() && !isThrottled()) || !framesToCompress.empty() || hasProxyFrames();
+}
+
+//call with loadMutex held. a throttled load has no work until its next slot, the worker that would
+//have slept through it goes to other sequences instead and preloadNextFrame asks the scheduler back for the slot
+bool ofxImageSequence::isThrottled()
+{
+	return useThread && loadThrottle != THROTTLE_NONE && ofGetElapsedTimeMicros() < nextThrottleSlot;
+}
+
+bool ofxImageSequence::runScheduledJob(ofxImageSequenceScheduler::Priority priority)
+{
+	if(priority == ofxImageSequenceScheduler::PRIORITY_VISIBLE){
+		return decodeRequestedFrame();
+	}
+	if(priority == ofxImageSequenceScheduler::PRIORITY_PREFETCH){
+		return prefetchNextFrame();
+	}
+
+	loadMutex.lock();
+	bool list = threadLoader != NULL && !threadLoader->listed && !threadLoader->listing && !threadLoader->cancelLoading;
+	if(list){
+		threadLoader->listing = true;
+	}
+	loadMutex.unlock();
+	if(!list){
+		return preloadNextFrame() || compressNextFrame() || buildNextProxy();
+	}
+
+	bool found = preloadAllFilenames();
+
+	ofScopedLock lock(loadMutex);
+	threadLoader->listing = false;
+	threadLoader->listed = true;
+	//streaming sequences only ever decode around the playhead, like preloadAllFrames
+	if(found && !threadLoader->cancelLoading && !streaming){
+		nextPreloadFrame = 0;
+		framesPreloaded = 0;
+		preloading = true;
+		finishPreload();
+	}
+	else{
+		threadLoader->loading = false;
+	}
+	frameStored.notify_all();
+	return true;
+}
+
+int ofxImageSequence::getSchedulerQuota(ofxImageSequenceScheduler::Priority priority)
+{
+	if(priority == ofxImageSequenceScheduler::PRIORITY_VISIBLE){
+		return -1;
+	}
+	ofScopedLock lock(loadMutex);
+	if(priority == ofxImageSequenceScheduler::PRIORITY_PRELOAD && threadLoader == NULL && preloading){
+		//a blocking preloadAllFrames decodes on the calling thread too
+		return getNumLoadThreads() - 1;
+	}
+	return getNumLoadThreads();
+}
+
+//decodes the frame a non-blocking setFrame or requestFrame is waiting on
+bool ofxImageSequence::decodeRequestedFrame()
+{
+	loadMutex.lock();
+	int index = -1;
+	if(requestedFrame >= 0 && requestedFrame < sequence.size() && beginDecode(requestedFrame)){
+		index = requestedFrame;
+	}
+	requestedFrame = -1;
+	loadMutex.unlock();
+
+	if(index < 0){
+		return false;
+	}
+
+	decodeAndStoreFrame(index);
+	return true;
+}
+
+bool ofxImageSequence::prefetchNextFrame()
+{
+	loadMutex.lock();
+	vector<int> frames;
+	getPrefetchFrames(frames);
+	int index = -1;
+	for(int i = 0; i < frames.size(); i++){
+		if(beginDecode(frames[i])){
+			index = frames[i];
+			break;
+		}
+	}
+	loadMutex.unlock();
+
+	if(index < 0){
+		return false;
+	}
+
+	decodeAndStoreFrame(index);
+	return true;
+}
+
+ofxImageSequenceStats& ofxImageSequence::getStats()
+{
+	return stats;
+}
+
+int ofxImageSequence::getQueueDepth()
+{
+	ofScopedLock lock(loadMutex);
+	int depth = framesDecoding.size();
+	if(requestedFrame >= 0){
+		depth++;
+	}
+	if(preloading && nextPreloadFrame < sequence.size()){
+		depth += sequence.size() - nextPreloadFrame;
+	}
+	return depth;
+}
+
+string ofxImageSequence::getStatsCsv()
+{
+	stringstream csv;
+	csv << "metric,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms" << endl;
+	for(int i = 0; i < ofxImageSequenceStats::NUM_STAGES; i++){
+		ofxImageSequenceStats::Stage stage = (ofxImageSequenceStats::Stage)i;
+		ofxImageSequenceStats::Summary summary = stats.getSummary(stage);
+		csv << ofxImageSequenceStats::getStageName(stage) << "," << summary.count << ","
+			<< summary.mean << "," << summary.p50 << "," << summary.p95 << "," << summary.p99 << "," << summary.max << endl;
+	}
+	csv << "cache_hits," << getCacheHits() << ",,,,," << endl;
+	csv << "cache_misses," << getCacheMisses() << ",,,,," << endl;
+	csv << "cache_evictions," << getCacheEvictions() << ",,,,," << endl;
+	csv << "resident_frames," << getCacheResidentFrames() << ",,,,," << endl;
+	csv << "resident_bytes," << getCacheResidentBytes() << ",,,,," << endl;
+	csv << "queue_depth," << getQueueDepth() << ",,,,," << endl;
+	return csv.str();
+}
+
+string ofxImageSequence::getStatsJson()
+{
+	stringstream json;
+	json << "{" << endl;
+	json << "\t\"stages\": {" << endl;
+	for(int i = 0; i < ofxImageSequenceStats::NUM_STAGES; i++){
+		ofxImageSequenceStats::Stage stage = (ofxImageSequenceStats::Stage)i;
+		ofxImageSequenceStats::Summary summary = stats.getSummary(stage);
+		json << "\t\t\"" << ofxImageSequenceStats::getStageName(stage) << "\": {"
+			<< "\"count\": " << summary.count
+			<< ", \"mean_ms\": " << summary.mean
+			<< ", \"p50_ms\": " << summary.p50
+			<< ", \"p95_ms\": " << summary.p95
+			<< ", \"p99_ms\": " << summary.p99
+			<< ", \"max_ms\": " << summary.max << "}"
+			<< (i + 1 < ofxImageSequenceStats::NUM_STAGES ? "," : "") << endl;
+	}
+	json << "\t}," << endl;
+	json << "\t\"cache_hits\": " << getCacheHits() << "," << endl;
+	json << "\t\"cache_misses\": " << getCacheMisses() << "," << endl;
+	json << "\t\"cache_evictions\": " << getCacheEvictions() << "," << endl;
+	json << "\t\"resident_frames\": " << getCacheResidentFrames() << "," << endl;
+	json << "\t\"resident_bytes\": " << getCacheResidentBytes() << "," << endl;
+	json << "\t\"queue_depth\": " << getQueueDepth() << endl;
+	json << "}" << endl;
+	return json.str();
+}
+
+bool ofxImageSequence::saveStats(string path)
+{
+	ofstream out(ofToDataPath(path).c_str());
+	if(!out.is_open()){
+		ofLogError("ofxImageSequence::saveStats") << "Could not open " << path << " for writing";
+		return false;
+	}
+	out << (ofToLower(ofFilePath::getFileExt(path)) == "json" ? getStatsJson() : getStatsCsv());
+	return out.good();
+}
+
+void ofxImageSequence::enableStreaming(int framesBehind, int framesAhead)
+{
+	ofScopedLock lock(loadMutex);
+	//enabling again only resizes the window, the settings to go back to are still the ones from before the first call
+	if(!streaming){
+		savedCacheMaxFrames = cacheMaxFrames;
+		savedPrefetchEnabled = prefetchEnabled;
+		savedPrefetchWindow = prefetchWindow;
+	}
+	streaming = true;
+	streamingBehind = MAX(framesBehind, 0);
+	streamingAhead = MAX(framesAhead, 1);
+	prefetchEnabled = true;
+	prefetchWindow = streamingAhead;
+	cacheMaxFrames = streamingBehind + streamingAhead + 1;
+	pixelPool.setCapacity(MAX(pixelPool.getCapacity(), getNumLoadThreads() + 2));
+	evictFrames(-1);
+	lock.unlock();
+	wakeScheduler();
+}
+
+void ofxImageSequence::disableStreaming()
+{
+	ofScopedLock lock(loadMutex);
+	if(!streaming){
+		return;
+	}
+	streaming = false;
+	cacheMaxFrames = savedCacheMaxFrames;
+	prefetchEnabled = savedPrefetchEnabled;
+	prefetchWindow = savedPrefetchWindow;
+	evictFrames(-1);
+	lock.unlock();
+	wakeScheduler();
+}
+
+void ofxImageSequence::setPixelPoolSize(int buffers)
+{
+	pixelPool.setCapacity(buffers);
+}
+
+ofxImageSequencePixelPool& ofxImageSequence::getPixelPool()
+{
+	return pixelPool;
+}
+
+bool ofxImageSequence::isStreaming()
+{
+	return streaming;
+}
+
+int ofxImageSequence::getNumLoadThreads()
+{
+	if(numLoadThreads > 0){
+		return numLoadThreads;
+	}
+	return MAX((int)thread::hardware_concurrency(), 1);
+}
+
+void ofxImageSequence::cancelLoad()
+{
+	//a load that already finished has nothing to resume, its loader is only still around until the next load
+	if(stopLoading()){
+		loadCancelled = true;
+	}
+
+	//whatever was decoded stays playable and resumeLoad carries on from here. a finished load the
+	//update event hasn't opened yet is opened here, its loader is gone
+	if(!loaded && sequence.size() > 0){
+		completeLoading();
+	}
+}
+
+bool ofxImageSequence::resumeLoad()
+{
+	if(isLoading()){
+		return true;
+	}
+	if(!loadCancelled){
+		ofLogError("ofxImageSequence::resumeLoad") << "No cancelled load to resume";
+		return false;
+	}
+
+	loadCancelled = false;
+	threadLoader = new ofxImageSequenceLoader(this);
+	if(sequence.size() > 0){
+		//frames already decoded are skipped, and nextPreloadFrame is still where the load stopped.
+		//a load cancelled before its folder was listed lists it again
+		ofScopedLock lock(loadMutex);
+		threadLoader->listed = true;
+		preloading = !streaming;
+		threadLoader->loading = preloading;
+		finishPreload();
+	}
+	scheduleJobs();
+	return true;
+}
+
+bool ofxImageSequence::isLoadCancelled()
+{
+	return loadCancelled;
+}
+
+//call without loadMutex held. stops a threaded load without opening what it got through, returns false if
+//there wasn't one or it had already finished
+bool ofxImageSequence::stopLoading()
+{
+	if(threadLoader == NULL){
+		return false;
+	}
+
+	ofxImageSequenceLoader* loader;
+	bool wasLoading;
+	{
+		//stop handing out preload jobs and wait for the ones already running
+		ofScopedLock lock(loadMutex);
+		wasLoading = threadLoader->loading;
+		threadLoader->cancelLoading = true;
+		preloading = false;
+		while(preloadJobsRunning > 0 || threadLoader->listing){
+			frameStored.wait(lock);
+		}
+		loader = threadLoader;
+		threadLoader = NULL;
+	}
+	delete loader;
+	return wasLoading;
+}
+
+void ofxImageSequence::setMinMagFilter(int newMinFilter, int newMagFilter)
+{
+	minFilter = newMinFilter;
+	magFilter = newMagFilter;
+	if(useTexture){
+		texture.setTextureMinMagFilter(minFilter, magFilter);
+	}
+}
+
+void ofxImageSequence::preloadAllFrames()
+{
+	if(sequence.size() == 0){
+		ofLogError("ofxImageSequence::loadFrame") << "Calling preloadAllFrames on unitialized image sequence.";
+		return;
+	}
+
+	if(streaming){
+		ofLogWarning("ofxImageSequence::preloadAllFrames") << "Streaming sequences only keep a window of frames around the playhead, not preloading";
+		return;
+	}
+
+	loadMutex.lock();
+	nextPreloadFrame = 0;
+	framesPreloaded = 0;
+	preloading = true;
+	loadMutex.unlock();
+
+	//this thread decodes too, scheduler workers join in up to the load thread count
+	if(getNumLoadThreads() > 1){
+		scheduleJobs();
+	}
+	while(preloadNextFrame()){
+	}
+
+	ofScopedLock lock(loadMutex);
+	while(preloadJobsRunning > 0){
+		frameStored.wait(lock);
+	}
+	preloading = false;
+}
+
+//call with loadMutex held
+bool ofxImageSequence::hasPreloadFrames()
+{
+	//with a bounded cache, stop once it is full rather than evicting frames we just preloaded.
+	//a compressed tier keeps taking frames after the decoded cache fills up
+	return nextPreloadFrame < sequence.size() && (!isCacheFull() || !isCompressedCacheFull());
+}
+
+//call with loadMutex held. a threaded load is done once nothing is left to hand out and the last frame is in
+void ofxImageSequence::finishPreload()
+{
+	if(threadLoader != NULL && preloading && preloadJobsRunning == 0 && !hasPreloadFrames()){
+		preloading = false;
+		threadLoader->loading = false;
+	}
+}
+
+bool ofxImageSequence::preloadNextFrame()
+{
+	loadMutex.lock();
+	int index = -1;
+	bool compressOnly = false;
+	//another worker may have taken the slot since the scheduler asked
+	bool throttled = isThrottled();
+	while(preloading && !throttled && hasPreloadFrames()){
+		int candidate = nextPreloadFrame++;
+		if(!isCacheFull()){
+			if(beginDecode(candidate)){
+				index = candidate;
+				break;
+			}
+		}
+		else if(!sequence[candidate].isAllocated() && !loadFailed[candidate] && !compressedFrames[candidate]){
+			index = candidate;
+			compressOnly = true;
+			break;
+		}
+		framesPreloaded++;
+	}
+	if(index >= 0){
+		preloadJobsRunning++;
+	}
+	else{
+		finishPreload();
+	}
+	LoadThrottle throttle = useThread ? loadThrottle : THROTTLE_NONE;
+	float throttleAmount = loadThrottleAmount;
+	uint64_t wakeTime = 0;
+	if(index >= 0 && throttle == THROTTLE_FRAMES_PER_SECOND){
+		//evenly spaced start times so all workers together stay within the budget
+		nextThrottleSlot = ofGetElapsedTimeMicros() + 1000000.0 / throttleAmount;
+		wakeTime = nextThrottleSlot;
+	}
+	loadMutex.unlock();
+
+	if(wakeTime > 0){
+		ofxImageSequenceScheduler::get().wakeAt(wakeTime);
+	}
+	if(index < 0){
+		return false;
+	}
+
+	uint64_t decodeStart = ofGetElapsedTimeMicros();
+	if(compressOnly){
+		ofPixels pixels;
+		pixelPool.acquire(pixels);
+		if(decodeFrameFromSource(index, pixels)){
+			compressFrame(index, pixels);
+		}
+		pixelPool.release(pixels);
+	}
+	else{
+		decodeAndStoreFrame(index);
+	}
+
+	loadMutex.lock();
+	framesPreloaded++;
+	preloadJobsRunning--;
+	if(throttle == THROTTLE_DUTY_CYCLE && throttleAmount < 1.0){
+		//rest in proportion to the time spent working so the load keeps workers busy only the requested fraction of the time
+		uint64_t now = ofGetElapsedTimeMicros();
+		uint64_t rest = (now - decodeStart) * (1.0 - throttleAmount) / throttleAmount;
+		nextThrottleSlot = MAX(nextThrottleSlot, now + rest);
+		wakeTime = nextThrottleSlot;
+	}
+	finishPreload();
+	frameStored.notify_all();
+	loadMutex.unlock();
+
+	if(wakeTime > 0){
+		ofxImageSequenceScheduler::get().wakeAt(wakeTime);
+	}
+	return true;
+}
+
+bool ofxImageSequence::decodeFrame(int imageIndex, DecodedFrame& frame)
+{
+	//raw files are already shared between sequences through the OS page cache
+	//trimmed frames carry an offset the shared cache has no room for and delta groups keep
+	//the frames they diff against, so both are always decoded privately. the compressed tier
+	//sits under private decodes only, shared frames are already held once for every sequence
+	if(!useSharedCache || rawFile.isOpen() || alphaTrim || usesDeltaFrames()){
+		//decode into a recycled buffer when there's one, frames in a sequence are all the same size
+		if(!rawFile.isOpen()){
+			pixelPool.acquire(frame.pixels);
+		}
+		if(rawFile.isOpen() || !decompressFrame(imageIndex, frame.pixels)){
+			if(!decodeFrameFromSource(imageIndex, frame.pixels)){
+				return false;
+			}
+			//compressing takes longer than the copy, so a caller waiting on the frame leaves it to a worker
+			if(!rawFile.isOpen() && ofxImageSequenceScheduler::isWorkerThread()){
+				compressFrame(imageIndex, frame.pixels);
+			}
+			else if(!rawFile.isOpen()){
+				deferCompress(imageIndex, frame.pixels);
+			}
+		}
+		if(alphaTrim && !rawFile.isOpen()){
+			trimFrame(frame);
+		}
+		return true;
+	}
+
+	//sequences converting to different layouts can't share frames
+	string key = packedFile.isOpen() ?
+		ofxImageSequenceSharedCache::makeKey(packedFile.getPath(), "#" + ofToString(frameNumbers[imageIndex]) + getPixelLayoutSuffix()) :
+		ofxImageSequenceSharedCache::makeKey(getFramePath(imageIndex), getPixelLayoutSuffix());
+	frame.shared = ofxImageSequenceSharedCache::get().acquire(key, bind(&ofxImageSequence::decodeFrameFromSource, this, imageIndex, placeholders::_1));
+	if(!frame.shared){
+		return false;
+	}
+
+	//the key carries the layout so this should never happen, but a frame in the wrong layout would show with red and blue swapped
+	ofPixels& shared = *frame.shared;
+	if(pixelLayout != PIXELS_NATIVE && shared.getPixelFormat() != (pixelLayout == PIXELS_BGRA ? OF_PIXELS_BGRA : OF_PIXELS_RGBA)){
+		ofLogError("ofxImageSequence::decodeFrame") << "Shared frame " << key << " isn't in the requested pixel layout, decoding it privately";
+		frame.shared.reset();
+		pixelPool.acquire(frame.pixels);
+		return decodeFrameFromSource(imageIndex, frame.pixels);
+	}
+
+	//the slot only views the shared pixels, frame.shared keeps them alive for as long as the slot does.
+	//the format has to come across too, counting channels would label every bgra frame rgba
+	frame.pixels.setFromExternalPixels(shared.getData(), shared.getWidth(), shared.getHeight(), shared.getPixelFormat());
+	return true;
+}
+
+//converts a decoded frame to the layout set with setPixelLayout. four channel frames that only need premultiplying
+//are done in place, anything else is written into a second buffer and the decoded one goes back to the pool
+void ofxImageSequence::normalizeFrame(ofPixels& pixels)
+{
+	if(pixelLayout == PIXELS_NATIVE){
+		if(premultiplied && pixels.getNumChannels() == 4){
+			ofxImageSequencePixelOps::convert(pixels, pixels, pixels.getPixelFormat() == OF_PIXELS_BGRA, true);
+		}
+		return;
+	}
+
+	ofPixelFormat format = pixelLayout == PIXELS_BGRA ? OF_PIXELS_BGRA : OF_PIXELS_RGBA;
+	if(pixels.getNumChannels() == 4 && pixels.getPixelFormat() == format){
+		if(premultiplied){
+			ofxImageSequencePixelOps::convert(pixels, pixels, pixelLayout == PIXELS_BGRA, true);
+		}
+		return;
+	}
+
+	ofPixels converted;
+	pixelPool.acquire(converted);
+	ofxImageSequencePixelOps::convert(pixels, converted, pixelLayout == PIXELS_BGRA, premultiplied);
+	pixels.swap(converted);
+	pixelPool.release(converted);
+}
+
+string ofxImageSequence::getPixelLayoutSuffix()
+{
+	string suffix;
+	if(pixelLayout == PIXELS_RGBA){
+		suffix = "rgba";
+	}
+	else if(pixelLayout == PIXELS_BGRA){
+		suffix = "bgra";
+	}
+	if(premultiplied){
+		suffix += "premultiplied";
+	}
+	return suffix == "" ? "" : "." + suffix;
 }
 
-ofxImageSequence::~ofxImageSequence()
+//crops a decoded frame to its visible pixels, keeping a pixel of transparent border so filtering fades out at the edges
+void ofxImageSequence::trimFrame(DecodedFrame& frame)
 {
-	unloadSequence();
-}
+	int frameWidth = frame.pixels.getWidth();
+	int frameHeight = frame.pixels.getHeight();
+	frame.untrimmedWidth = frameWidth;
+	frame.untrimmedHeight = frameHeight;
+
+	int x, y, w, h;
+	if(ofxImageSequencePixelOps::getAlphaBounds(frame.pixels, x, y, w, h)){
+		int right = MIN(x + w + 1, frameWidth);
+		int bottom = MIN(y + h + 1, frameHeight);
+		x = MAX(x - 1, 0);
+		y = MAX(y - 1, 0);
+		w = right - x;
+		h = bottom - y;
+	}
+	else{
+		//nothing visible, a single transparent pixel still counts as a loaded frame
+		x = 0;
+		y = 0;
+		w = 1;
+		h = 1;
+	}
+	frame.trim.set(x, y, w, h);
 
-bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit)
-{
-	return loadSequence(prefix, filetype, startDigit, endDigit, 0);
+	if(w == frameWidth && h == frameHeight){
+		return;
+	}
+	ofPixels cropped;
+	frame.pixels.cropTo(cropped, x, y, w, h);
+	pixelPool.release(frame.pixels);
+	frame.pixels.swap(cropped);
 }
 
-bool ofxImageSequence::loadSequence(string prefix, string filetype,  int startDigit, int endDigit, int numDigits)
+bool ofxImageSequence::decodeFrameFromSource(int imageIndex, ofPixels& pixels)
 {
-	unloadSequence();
-
-	char imagename[1024];
-	stringstream format;
-	int numFiles = endDigit - startDigit+1;
-	if(numFiles <= 0 ){
-		ofLogError("ofxImageSequence::loadSequence") << "No image files found.";
-		return false;
+	if(rawFile.isOpen()){
+		if(!rawFile.isFrameValid(frameNumbers[imageIndex])){
+			return false;
+		}
+		pixels.setFromExternalPixels(rawFile.getFrameData(frameNumbers[imageIndex]), rawFile.getWidth(), rawFile.getHeight(), rawFile.getPixelFormat());
+		return true;
 	}
 
-	if(numDigits != 0){
-		format <<prefix<<"%0"<<numDigits<<"d."<<filetype;
-	} else{
-		format <<prefix<<"%d."<<filetype; 
+	//read and decode separately so each shows up in the stats
+	uint64_t readStart = ofGetElapsedTimeMicros();
+	ofBuffer buffer;
+	if(packedFile.isOpen()){
+		packedFile.readFrame(frameNumbers[imageIndex], buffer);
 	}
-	
-	for(int i = startDigit; i <= endDigit; i++){
-		sprintf(imagename, format.str().c_str(), i);
-		filenames.push_back(imagename);
-		sequence.push_back(ofPixels());
-		loadFailed.push_back(false);
+	else{
+		if(loadedFromManifest){
+			checkManifestFrame(imageIndex);
+		}
+		buffer = ofBufferFromFile(getFramePath(imageIndex), true);
 	}
-	
-	loaded = true;
-	
-	lastFrameLoaded = -1;
-	loadFrame(0);
-	
-	width  = sequence[0].getWidth();
-	height = sequence[0].getHeight();
+	uint64_t decodeStart = ofGetElapsedTimeMicros();
+	stats.addSample(ofxImageSequenceStats::STAGE_READ, decodeStart - readStart);
+
+	if(buffer.size() == 0 || !ofLoadImage(pixels, buffer)){
+		ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << getFramePath(imageIndex);
+		return false;
+	}
+	normalizeFrame(pixels);
+	stats.addSample(ofxImageSequenceStats::STAGE_DECODE, ofGetElapsedTimeMicros() - decodeStart);
 	return true;
 }
 
-bool ofxImageSequence::loadSequence(string _folder)
+//call without loadMutex held. the manifest only vouches for the folder and the ends of the sequence, a frame
+//rewritten in place in between is caught here when it's decoded and its stats are brought up to date
+void ofxImageSequence::checkManifestFrame(int imageIndex)
 {
-	unloadSequence();
-
-	folderToLoad = _folder;
-
-	if(useThread){
-		threadLoader = new ofxImageSequenceLoader(this);
-		return true;
+	uint64_t size = 0, modified = 0;
+	ofxImageSequenceManifest::getFileStats(getFramePath(imageIndex), size, modified);
+	int probedWidth = 0, probedHeight = 0, probedChannels = 0;
+	{
+		ofScopedLock lock(loadMutex);
+		if(imageIndex >= manifest.frames.size()){
+			return;
+		}
+		ofxImageSequenceManifest::Frame& frame = manifest.frames[imageIndex];
+		if(size == frame.size && modified == frame.modified){
+			return;
+		}
+		frame.size = size;
+		frame.modified = modified;
+		manifestDirty = true;
 	}
 
-	if(preloadAllFilenames()){
-		completeLoading();
-		return true;
+	//the size the next load opens with comes from the first frame
+	if(imageIndex == 0 && readImageHeader(getFramePath(0), probedWidth, probedHeight, probedChannels)){
+		ofScopedLock lock(loadMutex);
+		manifest.width = probedWidth;
+		manifest.height = probedHeight;
+		manifest.channels = probedChannels;
 	}
-	
-	return false;
-
 }
 
-void ofxImageSequence::completeLoading()
+void ofxImageSequence::storeFrame(int imageIndex, DecodedFrame& frame, bool success)
 {
+	//every full frame that goes by leaves its proxy behind, while it's still in this thread's hands
+	ofPixels proxy;
+	if(success && proxyScale != PROXY_NONE){
+		loadMutex.lock();
+		bool needsProxy = !proxies[imageIndex].isAllocated();
+		loadMutex.unlock();
+		if(needsProxy){
+			makeProxy(imageIndex, frame.pixels, proxy);
+		}
+	}
 
-	if(sequence.size() == 0){
-		ofLogError("ofxImageSequence::completeLoading") << "load failed with empty image sequence";
+	ofScopedLock lock(loadMutex);
+	if(proxy.isAllocated() && !proxies[imageIndex].isAllocated()){
+		proxies[imageIndex].swap(proxy);
+	}
+	framesDecoding.erase(imageIndex);
+	frameStored.notify_all();
+	if(success && frame.untrimmedWidth > 0){
+		trimRects[imageIndex] = frame.trim;
+		untrimmedWidth = frame.untrimmedWidth;
+		untrimmedHeight = frame.untrimmedHeight;
+	}
+	if(!success){
+		loadFailed[imageIndex] = true;
+		manifestDirty = manifest.frames.size() > 0;
+	}
+	else if(!sequence[imageIndex].isAllocated()){
+		if(frame.patch.isAllocated()){
+			//only the region that changed is kept, the whole frame stays with the caller to diff the next one against
+			sequence[imageIndex].swap(frame.patch);
+			deltaPatches[imageIndex] = true;
+		}
+		else{
+			sequence[imageIndex].swap(frame.pixels);
+			deltaPatches[imageIndex] = false;
+		}
+		deltaRects[imageIndex] = frame.dirty;
+		sharedFrames[imageIndex] = frame.shared;
+		cacheResidentBytes += sequence[imageIndex].getTotalBytes();
+		cacheOrder.push_front(imageIndex);
+		cachePosition[imageIndex] = cacheOrder.begin();
+		evictFrames(imageIndex);
 		return;
 	}
 
-	loaded = true;	
-	lastFrameLoaded = -1;
-	loadFrame(0);
-	
-	width  = sequence[0].getWidth();
-	height = sequence[0].getHeight();
+	//failed, or someone else stored the frame first
+	if(!frame.patch.isAllocated()){
+		recycleFrame(frame.pixels, frame.shared, false);
+	}
+}
 
+float ofxImageSequence::percentLoaded(){
+	if(isLoading() || loadCancelled){
+		ofScopedLock lock(loadMutex);
+		if(threadLoader != NULL && !threadLoader->listed){
+			return 0.0;
+		}
+		return sequence.size() > 0 ? 1.0*framesPreloaded / sequence.size() : 0.0;
+	}
+	if(isLoaded()){
+		return 1.0;
+	}
+	return 0.0;
 }
 
-bool ofxImageSequence::preloadAllFilenames()
+void ofxImageSequence::loadFrame(int imageIndex)
 {
-    ofDirectory dir;
-	if(extension != ""){
-		dir.allowExt(extension);
-	}
-	
-	if(!ofFile(folderToLoad).exists()){
-		ofLogError("ofxImageSequence::loadSequence") << "Could not find folder " << folderToLoad;
-		return false;
+	if(lastFrameLoaded == imageIndex && !showingProxy){
+		return;
 	}
 
-	int numFiles;
-	if(maxFrames > 0){
-		numFiles = MIN(dir.listDir(folderToLoad), maxFrames);
+	if(imageIndex < 0 || imageIndex >= sequence.size()){
+		ofLogError("ofxImageSequence::loadFrame") << "Calling a frame out of bounds: " << imageIndex;
+		return;
 	}
-	else{	
-		numFiles = dir.listDir(folderToLoad);
+
+	bool needsDecode;
+	{
+		ofScopedLock lock(loadMutex);
+		bool waited = false;
+		while(framesDecoding.count(imageIndex) > 0){
+			//a background worker is already decoding this frame, wait for it rather than decoding it twice
+			waited = true;
+			frameStored.wait(lock);
+		}
+		needsDecode = beginDecode(imageIndex);
+		if(needsDecode || waited){
+			cacheMisses++;
+		}
+		else{
+			cacheHits++;
+			touchFrame(imageIndex);
+		}
 	}
 
-    if(numFiles == 0) {
-		ofLogError("ofxImageSequence::loadSequence") << "No image files found in " << folderToLoad;
-		return false;
+	if(needsDecode){
+		decodeAndStoreFrame(imageIndex);
 	}
 
-    // read the directory for the images
-	#ifdef TARGET_LINUX
-	dir.sort();
-	#endif
+	uploadFrame(imageIndex);
+}
+
+bool ofxImageSequence::uploadFrame(int imageIndex)
+{
+	const ofPixels* pixels;
+	ofRectangle dirty;
+	{
+		ofScopedLock lock(loadMutex);
+		if(loadFailed[imageIndex] || !sequence[imageIndex].isAllocated()){
+			return false;
+		}
 
+		if(usesDeltaFrames()){
+			if(!buildDeltaFrame(imageIndex, dirty)){
+				return false;
+			}
+			pixels = &deltaCanvas;
+		}
+		else{
+			pixels = &sequence[imageIndex];
+			dirty.set(0, 0, pixels->getWidth(), pixels->getHeight());
+		}
 
-	for(int i = 0; i < numFiles; i++) {
+		//the frame on screen is never evicted, so marking it shown pins it while it uploads without the lock.
+		//uploading under the lock would stall every decode worker, the scheduler takes it to look for work
+		lastDirtyRect = dirty;
+		lastFrameLoaded = imageIndex;
+		showingProxy = false;
+	}
 
-        filenames.push_back(dir.getPath(i));
-		sequence.push_back(ofPixels());
-		loadFailed.push_back(false);
-    }
+	if(useTexture && dirty.width > 0){
+		uint64_t uploadStart = ofGetElapsedTimeMicros();
+		if(dirty.width == pixels->getWidth() && dirty.height == pixels->getHeight()){
+			texture.loadData(*pixels);
+		}
+		else{
+			uploadRegion(*pixels, dirty);
+		}
+		stats.addSample(ofxImageSequenceStats::STAGE_UPLOAD, ofGetElapsedTimeMicros() - uploadStart);
+	}
 	return true;
 }
 
-//set to limit the number of frames. negative means no limit
-void ofxImageSequence::setMaxFrames(int newMaxFrames)
+//call with loadMutex held. rebuilds a delta frame in deltaCanvas, from where the canvas already is when that's on
+//the way, otherwise from the closest whole frame before it. when the texture held the canvas's old frame dirty is
+//just the union of the patches applied, otherwise the whole canvas
+bool ofxImageSequence::buildDeltaFrame(int imageIndex, ofRectangle& dirty)
 {
-	maxFrames = MAX(newMaxFrames, 0);
-	if(loaded){
-		ofLogError("ofxImageSequence::setMaxFrames") << "Max frames must be called before load";
+	int start = imageIndex;
+	while(start > 0 && deltaPatches[start]){
+		start--;
 	}
-}
 
-void ofxImageSequence::setExtension(string ext)
-{
-	extension = ext;
-}
-
-void ofxImageSequence::enableThreadedLoad(bool enable){
+	bool textureMatchesCanvas = deltaCanvasFrame == lastFrameLoaded && !showingProxy;
+	if(deltaCanvasFrame < start || deltaCanvasFrame > imageIndex){
+		if(!sequence[start].isAllocated()){
+			return false;
+		}
+		deltaCanvas = sequence[start];
+		deltaCanvasFrame = start;
+		textureMatchesCanvas = false;
+	}
 
-	if(loaded){
-		ofLogError("ofxImageSequence::enableThreadedLoad") << "Need to enable threaded loading before calling load";
+	dirty = ofRectangle();
+	for(int i = deltaCanvasFrame + 1; i <= imageIndex; i++){
+		if(!sequence[i].isAllocated()){
+			deltaCanvasFrame = -1;
+			return false;
+		}
+		if(deltaRects[i].width > 0){
+			sequence[i].pasteInto(deltaCanvas, deltaRects[i].x, deltaRects[i].y);
+			dirty = dirty.width > 0 ? dirty.getUnion(deltaRects[i]) : deltaRects[i];
+		}
+		deltaCanvasFrame = i;
 	}
-	useThread = enable;
-}
 
-void ofxImageSequence::cancelLoad()
-{
-	if(useThread && threadLoader != NULL){
-        threadLoader->cancel();
-        
-		delete threadLoader;
-		threadLoader = NULL;
+	bool sameSize = texture.isAllocated() && texture.getWidth() == deltaCanvas.getWidth() && texture.getHeight() == deltaCanvas.getHeight();
+	if(!textureMatchesCanvas || !sameSize){
+		dirty.set(0, 0, deltaCanvas.getWidth(), deltaCanvas.getHeight());
 	}
+	return true;
 }
 
-void ofxImageSequence::setMinMagFilter(int newMinFilter, int newMagFilter)
+//updates one region of the texture from the same region of pixels the size of the whole texture
+void ofxImageSequence::uploadRegion(const ofPixels& pixels, const ofRectangle& region)
 {
-	minFilter = newMinFilter;
-	magFilter = newMagFilter;
-	texture.setTextureMinMagFilter(minFilter, magFilter);
+#ifndef TARGET_OPENGLES
+	ofTextureData& data = texture.getTextureData();
+	size_t offset = ((size_t)region.y * pixels.getWidth() + region.x) * pixels.getNumChannels();
+	glBindTexture(data.textureTarget, data.textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, pixels.getWidth());
+	glTexSubImage2D(data.textureTarget, 0, region.x, region.y, region.width, region.height, ofGetGLFormat(pixels), GL_UNSIGNED_BYTE, pixels.getData() + offset);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(data.textureTarget, 0);
+#else
+	//no row length to step over the rest of each row with on ES 2
+	texture.loadData(pixels);
+#endif
 }
 
-void ofxImageSequence::preloadAllFrames()
+//shows the requested frame if it is already decoded, otherwise the closest decoded frame, without ever decoding on this thread
+void ofxImageSequence::showNearestFrame(int imageIndex)
 {
-	if(sequence.size() == 0){
-		ofLogError("ofxImageSequence::loadFrame") << "Calling preloadAllFrames on unitialized image sequence.";
-		return;
-	}
-	
-	for(int i = 0; i < sequence.size(); i++){
-		//threaded stuff
-		if(useThread){
-			if(threadLoader == NULL){
-				return;
-			}
-            threadLoader->lock();
-            bool shouldExit = threadLoader->cancelLoading;
-            threadLoader->unlock();
-            if(shouldExit){
-                return;
-            }
-
-			ofSleepMillis(15);
+	int frameToShow = -1;
+	bool proxy = false;
+	{
+		ofScopedLock lock(loadMutex);
+		if(sequence[imageIndex].isAllocated()){
+			frameToShow = imageIndex;
+			cacheHits++;
+			touchFrame(imageIndex);
 		}
-		curLoadFrame = i;
-		if(!ofLoadImage(sequence[i], filenames[i])){
-			loadFailed[i] = true;
-			ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << filenames[i];		
+		else if(proxies[imageIndex].isAllocated()){
+			//the right frame at low resolution beats the wrong frame at full resolution
+			frameToShow = imageIndex;
+			proxy = true;
+			cacheMisses++;
+		}
+		else{
+			cacheMisses++;
+			int bestDistance = lastFrameLoaded >= 0 ? abs(lastFrameLoaded - imageIndex) : sequence.size();
+			for(list<int>::iterator it = cacheOrder.begin(); it != cacheOrder.end(); it++){
+				if(abs(*it - imageIndex) < bestDistance){
+					bestDistance = abs(*it - imageIndex);
+					frameToShow = *it;
+				}
+			}
 		}
 	}
-}
 
-float ofxImageSequence::percentLoaded(){
-	if(isLoaded()){
-		return 1.0;
+	if(proxy){
+		if(frameToShow != lastFrameLoaded || !showingProxy){
+			uploadProxy(frameToShow);
+		}
 	}
-	if(isLoading() && sequence.size() > 0){
-		return 1.0*curLoadFrame / sequence.size();
+	else if(frameToShow >= 0 && (frameToShow != lastFrameLoaded || showingProxy)){
+		uploadFrame(frameToShow);
 	}
-	return 0.0;
 }
 
-void ofxImageSequence::loadFrame(int imageIndex)
+void ofxImageSequence::updateAsyncFrame(ofEventArgs& args)
 {
-	if(lastFrameLoaded == imageIndex){
-		return;
-	}
-
-	if(imageIndex < 0 || imageIndex >= sequence.size()){
-		ofLogError("ofxImageSequence::loadFrame") << "Calling a frame out of bounds: " << imageIndex;
+	if(!loaded || (lastFrameLoaded == currentFrame && !showingProxy) || currentFrame >= sequence.size()){
 		return;
 	}
 
-	if(!sequence[imageIndex].isAllocated() && !loadFailed[imageIndex]){
-		if(!ofLoadImage(sequence[imageIndex], filenames[imageIndex])){
-			loadFailed[imageIndex] = true;
-			ofLogError("ofxImageSequence::loadFrame") << "Image failed to load: " << filenames[imageIndex];
+	bool resident;
+	{
+		ofScopedLock lock(loadMutex);
+		resident = sequence[currentFrame].isAllocated();
+		if(!resident && framesDecoding.count(currentFrame) == 0 && !loadFailed[currentFrame]){
+			//the stand-in is still up but the frame isn't coming, it may have been evicted before we got to it
+			requestedFrame = currentFrame;
 		}
 	}
 
-	if(loadFailed[imageIndex]){
-		return;
+	if(resident){
+		uploadFrame(currentFrame);
+	}
+	else{
+		wakeScheduler();
 	}
-
-	texture.loadData(sequence[imageIndex]);
-
-	lastFrameLoaded = imageIndex;
-
 }
 
 float ofxImageSequence::getPercentAtFrameIndex(int index)
@@ -363,21 +2835,87 @@ float ofxImageSequence::getHeight()
 	return height;
 }
 
+int ofxImageSequence::getNumChannels()
+{
+	return numChannels;
+}
+
 void ofxImageSequence::unloadSequence()
 {
-	if(threadLoader != NULL){
-		delete threadLoader;
-		threadLoader = NULL;
+	stopLoading();
+	loadCancelled = false;
+
+	//waits for any of our frames still being decoded
+	if(jobs != NULL){
+		ofxImageSequenceScheduler::get().removeSource(jobs);
+		delete jobs;
+		jobs = NULL;
+	}
+
+	//frames that failed since the manifest was written are skipped next time
+	if(manifestDirty && manifest.frames.size() == loadFailed.size()){
+		for(int i = 0; i < loadFailed.size(); i++){
+			manifest.frames[i].failed = loadFailed[i];
+		}
+		manifest.save(ofxImageSequenceManifest::getPathForFolder(folderToLoad));
 	}
+	manifest.clear();
+	manifestDirty = false;
+	loadedFromManifest = false;
 
+	//keep some buffers around, the next sequence loaded is likely the same size
+	for(int i = 0; i < sequence.size(); i++){
+		recycleFrame(sequence[i], sharedFrames[i], deltaPatches[i]);
+	}
 	sequence.clear();
+	sharedFrames.clear();
+	proxies.clear();
+	trimRects.clear();
+	deltaRects.clear();
+	deltaPatches.clear();
+	compressedFrames.clear();
+	compressedOrder.clear();
+	for(map<int, ofPixels>::iterator it = framesToCompress.begin(); it != framesToCompress.end(); it++){
+		pixelPool.release(it->second);
+	}
+	framesToCompress.clear();
+	compressedPosition.clear();
+	compressedResidentBytes = 0;
+	compressedSourceBytes = 0;
+	deltaCanvas.clear();
+	deltaCanvasFrame = -1;
+	showingProxy = false;
 	filenames.clear();
+	frameNumbers.clear();
+	compactNames = false;
+	namePrefix = "";
+	nameSuffix = "";
+	nameDigits = 0;
+	frameGaps.clear();
+	duplicateFrameNumbers.clear();
+	sourceFirst = 0;
+	sourceStride = 1;
 	loadFailed.clear();
+	packedFile.close();
+	rawFile.close();
+	cacheOrder.clear();
+	cachePosition.clear();
+	cacheResidentBytes = 0;
+	framesDecoding.clear();
+	requestedFrame = -1;
+	playheadHistory.clear();
+	playheadStep = 0;
+	playheadPingPong = false;
+	playheadScrubbing = false;
 
 	loaded = false;
 	width = 0;
 	height = 0;
-	curLoadFrame = 0;
+	numChannels = 0;
+	nextPreloadFrame = 0;
+	framesPreloaded = 0;
+	buildingProxies = false;
+	nextProxyFrame = 0;
 	lastFrameLoaded = -1;
 	currentFrame = 0;	
 
@@ -388,14 +2926,108 @@ void ofxImageSequence::setFrameRate(float rate)
 	frameRate = rate;
 }
 
+float ofxImageSequence::getFrameRate()
+{
+	return frameRate;
+}
+
+bool ofxImageSequence::isFrameReady(int index)
+{
+	ofScopedLock lock(loadMutex);
+	if(!loaded || index < 0 || index >= sequence.size()){
+		return false;
+	}
+	return isFrameResident(index);
+}
+
+//call with loadMutex held. the one test behind every ready query, raw frames are mapped rather than cached so cacheOrder won't do
+bool ofxImageSequence::isFrameResident(int index)
+{
+	return sequence[index].isAllocated() && !loadFailed[index];
+}
+
+vector<bool> ofxImageSequence::getReadyFrames()
+{
+	ofScopedLock lock(loadMutex);
+	vector<bool> ready;
+	if(!loaded){
+		return ready;
+	}
+	ready.resize(sequence.size());
+	for(int i = 0; i < sequence.size(); i++){
+		ready[i] = isFrameResident(i);
+	}
+	return ready;
+}
+
+int ofxImageSequence::getNumReadyFrames()
+{
+	ofScopedLock lock(loadMutex);
+	if(!loaded){
+		return 0;
+	}
+	int count = 0;
+	for(int i = 0; i < sequence.size(); i++){
+		if(isFrameResident(i)){
+			count++;
+		}
+	}
+	return count;
+}
+
+void ofxImageSequence::requestFrame(int index)
+{
+	if(!loaded || index < 0 || index >= sequence.size()){
+		return;
+	}
+	loadMutex.lock();
+	if(!sequence[index].isAllocated() && !loadFailed[index]){
+		requestedFrame = index;
+	}
+	loadMutex.unlock();
+	scheduleJobs();
+}
+
 string ofxImageSequence::getFilePath(int index){
-	if(index > 0 && index < filenames.size()){
-		return filenames[index];
+	if(index >= 0 && index < frameNumbers.size()){
+		return getFramePath(index);
 	}
 	ofLogError("ofxImageSequence::getFilePath") << "Getting filename outside of range";
 	return "";
 }
 
+int ofxImageSequence::getSourceFrameIndex(int index){
+	if(index >= 0 && index < frameNumbers.size()){
+		return sourceFirst + index * sourceStride;
+	}
+	ofLogError("ofxImageSequence::getSourceFrameIndex") << "Getting source frame outside of range";
+	return -1;
+}
+
+int ofxImageSequence::getFrameIndexForSourceFrame(int sourceIndex){
+	if(frameNumbers.size() == 0){
+		return -1;
+	}
+	//the nearest frame the stride kept
+	return ofClamp(roundf((sourceIndex - sourceFirst) / (float)sourceStride), 0, frameNumbers.size() - 1);
+}
+
+int ofxImageSequence::getFrameNumber(int index){
+	if(index >= 0 && index < frameNumbers.size()){
+		return frameNumbers[index];
+	}
+	ofLogError("ofxImageSequence::getFrameNumber") << "Getting frame number outside of range";
+	return -1;
+}
+
+const vector<pair<int, int> >& ofxImageSequence::getFrameGaps(){
+	return frameGaps;
+}
+
+const vector<int>& ofxImageSequence::getDuplicateFrameNumbers(){
+	return duplicateFrameNumbers;
+}
+
 int ofxImageSequence::getFrameIndexAtPercent(float percent)
 {
     if (percent < 0.0 || percent > 1.0) percent -= floor(percent);
@@ -460,9 +3092,39 @@ void ofxImageSequence::setFrame(int index)
 	}
 	
 	index %= getTotalFrames();
-	
-	loadFrame(index);
+
+	bool useProxy = false;
+	bool background = prefetchEnabled || asyncFrames || streaming || proxyScale != PROXY_NONE;
+	if(background){
+		ofScopedLock lock(loadMutex);
+		notePlayhead(index);
+		if(streaming){
+			trimStreamingWindow(index);
+		}
+		//while the playhead is moving fast a proxy stands in and the full frame is decoded in the background
+		bool movingFast = playheadScrubbing || abs(playheadStep) > 1;
+		useProxy = movingFast && !sequence[index].isAllocated() && proxies[index].isAllocated();
+		if((asyncFrames || useProxy) && !sequence[index].isAllocated()){
+			requestedFrame = index;
+		}
+		if(useProxy && !asyncFrames){
+			cacheMisses++;
+		}
+	}
+	if(background){
+		scheduleJobs();
+	}
+
 	currentFrame = index;
+	if(asyncFrames){
+		showNearestFrame(index);
+	}
+	else if(useProxy){
+		uploadProxy(index);
+	}
+	else{
+		loadFrame(index);
+	}
 }
 
 void ofxImageSequence::setFrameForTime(float time)
@@ -477,6 +3139,51 @@ void ofxImageSequence::setFrameAtPercent(float percent)
 	setFrame(getFrameIndexAtPercent(percent));	
 }
 
+const ofPixels& ofxImageSequence::getPixelsForFrame(int index)
+{
+	setFrame(index);
+	return getPixels();
+}
+
+const ofPixels& ofxImageSequence::getPixelsForTime(float time)
+{
+	setFrameForTime(time);
+	return getPixels();
+}
+
+const ofPixels& ofxImageSequence::getPixelsForPercent(float percent)
+{
+	setFrameAtPercent(percent);
+	return getPixels();
+}
+
+const ofPixels& ofxImageSequence::getPixels()
+{
+	if(lastFrameLoaded < 0 || lastFrameLoaded >= sequence.size()){
+		return emptyPixels;
+	}
+	if(showingProxy){
+		return proxies[lastFrameLoaded];
+	}
+	if(deltaCanvasFrame == lastFrameLoaded){
+		return deltaCanvas;
+	}
+	return sequence[lastFrameLoaded];
+}
+
+void ofxImageSequence::setUseTexture(bool bUseTex)
+{
+	useTexture = bUseTex;
+	if(!useTexture && texture.isAllocated()){
+		texture.clear();
+	}
+}
+
+bool ofxImageSequence::isUsingTexture() const
+{
+	return useTexture;
+}
+
 ofTexture& ofxImageSequence::getTexture()
 {
 	return texture;
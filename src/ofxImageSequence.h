@@ -47,18 +47,145 @@
 #pragma once
 
 #include "ofMain.h"
+#include "ofxImageSequencePackedFile.h"
+#include "ofxImageSequenceRawFile.h"
+#include "ofxImageSequenceSharedCache.h"
+#include "ofxImageSequenceStats.h"
+#include "ofxImageSequencePixelPool.h"
+#include "ofxImageSequenceManifest.h"
+#include "ofxImageSequencePixelOps.h"
+#include "ofxImageSequenceCodec.h"
+#include "ofxImageSequenceScheduler.h"
 
 class ofxImageSequenceLoader;
+class ofxImageSequenceJobs;
 class ofxImageSequence : public ofBaseHasTexture {
   public:
 
+	enum LoadThrottle {
+		THROTTLE_NONE,				//background workers decode as fast as they can
+		THROTTLE_FRAMES_PER_SECOND,	//all workers together decode at most amount frames per second
+		THROTTLE_DUTY_CYCLE			//workers are busy with the load at most amount (0.0 - 1.0) of the time, free for other sequences the remainder
+	};
+
+	enum ProxyScale {
+		PROXY_NONE		= 1,
+		PROXY_HALF		= 2,
+		PROXY_QUARTER	= 4,
+		PROXY_EIGHTH	= 8
+	};
+
+	enum PixelLayout {
+		PIXELS_NATIVE,		//whatever the file decoded to
+		PIXELS_RGBA,
+		PIXELS_BGRA
+	};
+
 	ofxImageSequence();
 	~ofxImageSequence();
 	
 	//sets an extension, like png or jpg
 	void setExtension(string prefix);
 	void setMaxFrames(int maxFrames); //set to limit the number of frames. 0 or less means no limit
+
+	//loads only part of a sequence: frames firstFrame to lastFrame (-1 for the end) of what would otherwise load, counted
+	//from 0, keeping every stride-th of them. only those frames are indexed, decoded and cached, so indices, times and
+	//percents all refer to the selection. the frame limit applies after the range and stride. set the frame rate to
+	//the source's divided by the stride to keep playback speed
+	void setFrameRange(int firstFrame, int lastFrame = -1);
+	void setFrameStride(int stride);
+	int getFrameRangeFirst();
+	int getFrameRangeLast();
+	int getFrameStride();
 	void enableThreadedLoad(bool enable);
+	void enableSharedCache(bool enable); //share decoded frames with every other sequence that enabled it and points at the same files
+	void enableLazyOpen(bool enable); //when enabled loading only reads the first frame's header for its size, nothing is decoded until a frame is needed
+	void setPixelLayout(PixelLayout layout, bool premultiplied = false); //converts every frame to four channels on the decode threads so uploads never change format. raw files are used as written
+	PixelLayout getPixelLayout();
+	bool isPremultiplied();
+
+	//crops each frame to the bounds of its visible pixels as it's decoded, so only those are cached and uploaded.
+	//the texture and pixels then hold just that region, draw them at getTrimRect to put them back in place.
+	//use with setPixelLayout(PIXELS_RGBA, true) so the cut edges blend the same as the full frame would
+	void enableAlphaTrim(bool enable);
+	bool isAlphaTrimEnabled();
+	ofRectangle getTrimRect();				//where the displayed frame sits within the full frame
+	ofRectangle getTrimRectForFrame(int index);	//the full frame until the frame has been decoded
+
+	//keeps every keyframeInterval-th frame whole and only the rectangle that changed since the frame before for the
+	//rest, for sequences where little moves between frames. frames are decoded a group at a time and rebuilt when
+	//shown, and playing forward only uploads what changed. 0 turns it off
+	void enableDeltaFrames(int keyframeInterval);
+	int getDeltaKeyframeInterval();
+	ofRectangle getDirtyRect();				//region of the texture the last frame change updated, empty if nothing changed
+	ofRectangle getDirtyRectForFrame(int index);	//what differs from the frame before, the whole frame for keyframes
+	void enableManifest(bool enable); //folder loads write a manifest beside the folder and reuse it next time instead of scanning, until the folder changes
+	bool isLoadedFromManifest();
+	void setNumLoadThreads(int numThreads); //most decode scheduler workers this sequence's preloading and prefetching may take at once, preloadAllFrames counts its own thread as one. 0 or less uses one per core, default is 1
+	int getNumLoadThreads();
+	void setLoadThrottle(LoadThrottle mode, float amount = 0); //limits how hard threaded loading works so it can yield to rendering, default is THROTTLE_NONE
+	LoadThrottle getLoadThrottle();
+
+	//bounds the decoded frame cache, evicting least recently used frames which are decoded again when next needed. 0 means no limit (default)
+	void setCacheBudgetBytes(uint64_t bytes);
+	void setCacheMaxFrames(int frames);
+	uint64_t getCacheResidentBytes();
+	int getCacheResidentFrames();
+	uint64_t getCacheHits();				//frames found decoded by loadFrame
+	uint64_t getCacheMisses();				//frames loadFrame had to decode
+	uint64_t getCacheEvictions();
+	void resetCacheStats();
+
+	//a tier below the decoded frames: every frame decoded is also kept losslessly compressed, up to this many bytes,
+	//and decompressed instead of decoded from its file next time it's needed. 0 turns it off (default)
+	void setCompressedCacheBudgetBytes(uint64_t bytes);
+	uint64_t getCompressedCacheBudgetBytes();
+	uint64_t getCompressedCacheResidentBytes();
+	int getCompressedCacheFrames();
+	uint64_t getCompressedCacheHits();		//decodes the compressed tier saved
+	float getCompressionRatio();			//uncompressed over compressed size of the frames in the tier
+
+	//per stage timings with rolling percentiles, for tracking down hitches without a profiler
+	ofxImageSequenceStats& getStats();
+	int getQueueDepth();					//frames waiting to be decoded or being decoded right now
+	string getStatsCsv();
+	string getStatsJson();
+	bool saveStats(string path);			//writes json if path ends in .json, csv otherwise
+
+	//for sequences far larger than memory. keeps only the frames from framesBehind before the playhead to framesAhead
+	//after it decoded, prefetching ahead and recycling the buffers of frames that fall out of the window. this takes over
+	//the prefetch window and the cache frame limit, and preloadAllFrames does nothing while streaming. disableStreaming
+	//puts back the cache limit and prefetch settings from before enableStreaming
+	void enableStreaming(int framesBehind, int framesAhead);
+	void disableStreaming();
+	bool isStreaming();
+
+	//evicted and unloaded frames hand their buffers to a pool that the next decode writes into,
+	//so playback with a bounded cache stops allocating once it settles. default is 8 buffers
+	void setPixelPoolSize(int buffers);
+	ofxImageSequencePixelPool& getPixelPool();
+
+	//decodes frames ahead of the playhead on the shared decode scheduler, following the direction and speed of setFrame calls
+	void enablePrefetch(bool enable);
+	bool isPrefetchEnabled();
+	void setPrefetchWindow(int frames);		//how many upcoming frames to keep decoded, default is 8
+	int getPrefetchWindow();
+
+	//when enabled setFrame and the getTexture* calls never decode on the calling thread. frames that aren't decoded yet
+	//are queued for the background decoder and the closest decoded frame is shown until they arrive
+	void enableAsyncFrames(bool enable);
+	bool isAsyncFramesEnabled();
+	bool isFrameExact();					//returns true if the texture holds the current frame rather than a stand-in
+	int getDisplayedFrame();				//index of the frame actually in the texture
+
+	//reduced resolution copies of each frame shown while the playhead moves fast, replaced by the full frame once it
+	//settles. proxies are made from every decoded frame, buildProxies fills in the rest in the background. with
+	//saveToDisk they're kept in a .proxyN folder beside the frames for next time. the texture shrinks while a
+	//proxy is up, so draw with getWidth and getHeight to keep the size steady
+	void enableProxies(ProxyScale scale, bool saveToDisk = false);
+	ProxyScale getProxyScale();
+	void buildProxies();
+	bool isShowingProxy();
 
 	/**
 	 *	use this method to load sequences formatted like:
@@ -90,13 +217,28 @@ class ofxImageSequence : public ofBaseHasTexture {
 	 *	numDigits	=> 3
 	 */
 	bool loadSequence(string prefix, string filetype, int startIndex, int endIndex, int numDigits);
+	bool loadSequence(string prefix, string filetype, int startIndex, int endIndex, int numDigits, int stride); //every stride-th frame from startIndex, for this load only
+
+	/**
+	 *	Loads every image in a folder, in file name order. folder can also be
+	 *	a packed sequence file written by savePackedSequence, which is read
+	 *	with a single open and one seek per frame, or a raw sequence file
+	 *	written by saveRawSequence, which is memory mapped and never decoded
+	 */
     bool loadSequence(string folder);
+	bool loadSequence(string folder, int firstFrame, int lastFrame, int stride = 1); //this range and stride for this load only, setFrameRange and setFrameStride are left alone
+
+	bool savePackedSequence(string packedPath);	//writes the loaded sequence's image files into a single packed file
+	bool saveRawSequence(string rawPath);		//decodes every frame into an uncompressed, memory mappable file. large on disk but instant to load
 
-	void cancelLoad();
+	void cancelLoad();				//stops a threaded load, keeping the frames it decoded. the sequence opens with what's listed so far
+	bool resumeLoad();				//carries on a cancelled threaded load from where it stopped
+	bool isLoadCancelled();
 	void preloadAllFrames();		//immediately loads all frames in the sequence, memory intensive but fastest scrubbing
 	void unloadSequence();			//clears out all frames and frees up memory
 
 	void setFrameRate(float rate); //used for getting frames by time, default is 30fps	
+	float getFrameRate();
 
 	//these get textures, but also change the
 	OF_DEPRECATED_MSG("Use getTextureForFrame instead.",   ofTexture* getFrame(int index));		 //returns a frame at a given index
@@ -107,20 +249,33 @@ class ofxImageSequence : public ofBaseHasTexture {
 	ofTexture& getTextureForTime(float time); //returns a frame at a given time, used setFrameRate to set time
 	ofTexture& getTextureForPercent(float percent); //returns a frame at a given time, used setFrameRate to set time
 
+	//the decoded pixels behind the texture, for feeding encoders or analysis without going through the GPU.
+	//combine with setUseTexture(false) to skip uploads entirely. the reference stays valid until the
+	//frame changes, the frame on screen is never evicted from the cache
+	const ofPixels& getPixelsForFrame(int index);
+	const ofPixels& getPixelsForTime(float time);
+	const ofPixels& getPixelsForPercent(float percent);
+	const ofPixels& getPixels();				//pixels of the frame currently shown
+
 	//if usinsg getTextureRef() use these to change the internal state
 	void setFrame(int index);					
 	void setFrameForTime(float time);			
 	void setFrameAtPercent(float percent);
 	
 	string getFilePath(int index);
+	int getFrameNumber(int index);			//the number parsed from a frame's file name, -1 if it has none
+	int getSourceFrameIndex(int index);		//where a frame sits in the sequence before the range and stride picked it
+	int getFrameIndexForSourceFrame(int sourceIndex);	//the loaded frame nearest a source frame
+	const vector<pair<int, int> >& getFrameGaps();		//numbers missing from a folder's sequence as (first missing, count) runs
+	const vector<int>& getDuplicateFrameNumbers();	//numbers shared by more than one file, eg frame1.png and frame01.png
 
 	OF_DEPRECATED_MSG("Use getTexture() instead.", ofTexture& getTextureReference());
 
 	virtual ofTexture& getTexture();
 	virtual const ofTexture& getTexture() const;
 
-	virtual void setUseTexture(bool bUseTex){/* not used */};
-	virtual bool isUsingTexture() const{return true;}
+	virtual void setUseTexture(bool bUseTex);	//set to false to skip texture uploads, eg when running without a GL context
+	virtual bool isUsingTexture() const;
 
 	int getFrameIndexAtPercent(float percent);	//returns percent (0.0 - 1.0) for a given frame
 	float getPercentAtFrameIndex(int index);	//returns a frame index for a percent
@@ -131,9 +286,14 @@ class ofxImageSequence : public ofBaseHasTexture {
 	
 	float getWidth();						//returns the width/height of the sequence
 	float getHeight();
-	bool isLoaded();						//returns true if the sequence has been loaded
-	bool isLoading();						//returns true if loading during thread
+	int getNumChannels();
+	bool isLoaded();						//returns true once frames can be shown, a threaded load gets there as soon as the folder is listed
+	bool isLoading();						//returns true while a threaded load is still decoding frames
 	void loadFrame(int imageIndex);			//allows you to load (cache) a frame to avoid a stutter when loading. use this to "read ahead" if you want
+	bool isFrameReady(int index);			//returns true if the frame is decoded and can be shown without a stall
+	vector<bool> getReadyFrames();			//isFrameReady for every frame at once, eg to draw load progress
+	int getNumReadyFrames();
+	void requestFrame(int index);			//queues a frame for the background decoder without waiting for it
 	
 	void setMinMagFilter(int minFilter, int magFilter);
 
@@ -144,22 +304,201 @@ class ofxImageSequence : public ofBaseHasTexture {
 	float percentLoaded();
 
   protected:
+	friend class ofxImageSequenceJobs;
+	friend class ofxImageSequenceLoader;
+
+	struct CompressedFrame {
+		vector<unsigned char> data;
+		bool isCompressed;			//false when compressing didn't help and data is the plain pixels
+		int width;
+		int height;
+		ofPixelFormat format;
+		uint64_t sourceBytes;
+	};
+
+	struct DecodedFrame {
+		ofPixels pixels;
+		shared_ptr<ofPixels> shared;	//set when pixels is a view into a frame held by the shared cache
+		ofRectangle trim;				//region of the full frame pixels holds, when trimmed
+		int untrimmedWidth;				//0 when the frame wasn't trimmed
+		int untrimmedHeight;
+		ofPixels patch;					//when set it's stored instead of pixels, the region of pixels at dirty
+		ofRectangle dirty;
+
+		DecodedFrame() : untrimmedWidth(0), untrimmedHeight(0) {}
+	};
+
+	bool stopLoading();
+	bool preloadNextFrame();		//decodes the next frame off the shared preload queue, returns false when there is nothing left to do
+	bool hasPreloadFrames();
+	bool isThrottled();
+	void finishPreload();
+	bool decodeFrame(int imageIndex, DecodedFrame& frame);
+	bool decodeFrameFromSource(int imageIndex, ofPixels& pixels);
+	void checkManifestFrame(int imageIndex);
+	void normalizeFrame(ofPixels& pixels);
+	void trimFrame(DecodedFrame& frame);
+	string getPixelLayoutSuffix();
+	void storeFrame(int imageIndex, DecodedFrame& frame, bool success);
+	void reserveFrames(int numFrames);
+	void addFrame(const string& path, int number = -1);
+	void addFrame(int number);		//a frame whose path is namePrefix + number + nameSuffix
+	string getFramePath(int imageIndex);
+	bool probeFrameSize(int imageIndex);
+	bool preloadPackedFilenames();
+	bool selectFrames(int numSource, int& first, int& count);
+	void setLoadSelection(int firstFrame, int lastFrame, int stride);
+	bool preloadManifestFilenames();
+	void writeManifest(uint64_t folderModified);
+	bool preloadRawFilenames();
+	bool isCacheFull();
+	bool isCompressedCacheFull();
+	void evictCompressedFrames(int keepIndex);
+	void compressFrame(int imageIndex, const ofPixels& pixels);
+	void deferCompress(int imageIndex, const ofPixels& pixels);
+	bool compressNextFrame();
+	bool decompressFrame(int imageIndex, ofPixels& pixels);
+	void evictFrames(int keepIndex);
+	void evictFrame(int imageIndex);
+	void recycleFrame(ofPixels& pixels, const shared_ptr<ofPixels>& shared, bool patch);
+	void trimStreamingWindow(int index);
+	void touchFrame(int imageIndex);
+	bool beginDecode(int imageIndex);
+	void decodeAndStoreFrame(int imageIndex);
+	void decodeDeltaGroup(int imageIndex);
+	int getDeltaGroupStart(int imageIndex);
+	bool usesDeltaFrames();
+	void notePlayhead(int index);
+	void getPrefetchFrames(vector<int>& frames);
+	bool prefetchNextFrame();
+	bool decodeRequestedFrame();
+	bool canDecode(int imageIndex);
+	bool isFrameResident(int index);
+	void scheduleJobs();
+	void wakeScheduler();
+	bool hasScheduledJob(ofxImageSequenceScheduler::Priority priority);
+	bool runScheduledJob(ofxImageSequenceScheduler::Priority priority);
+	int getSchedulerQuota(ofxImageSequenceScheduler::Priority priority);
+	bool uploadFrame(int imageIndex);
+	bool buildDeltaFrame(int imageIndex, ofRectangle& dirty);
+	void uploadRegion(const ofPixels& pixels, const ofRectangle& region);
+	void showNearestFrame(int imageIndex);
+	void updateAsyncFrame(ofEventArgs& args);
+	void updateListener();
+	string getProxyPath(int imageIndex);
+	void buildProxy(int imageIndex);
+	bool buildNextProxy();
+	bool hasProxyFrames();
+	void makeProxy(int imageIndex, const ofPixels& pixels, ofPixels& proxy);
+	bool uploadProxy(int imageIndex);
+
 	ofxImageSequenceLoader* threadLoader;
+	ofxImageSequenceJobs* jobs;		//our place in the decode scheduler, NULL until something needs decoding in the background
+	ofMutex loadMutex;				//guards sequence, loadFailed and the preload queue while decode workers are running
+	condition_variable_any frameStored;
+	set<int> framesDecoding;		//frames claimed by a worker that haven't been stored yet
 
 	vector<ofPixels> sequence;
-	vector<string> filenames;
+	vector<shared_ptr<ofPixels> > sharedFrames;	//keeps shared cache frames alive while sequence views them
+	vector<ofPixels> proxies;
+	ProxyScale proxyScale;
+	bool proxiesOnDisk;
+	bool showingProxy;
+	bool buildingProxies;			//buildProxies is handing frames to the scheduler
+	int nextProxyFrame;
+	vector<string> filenames;		//only filled when the names don't share a pattern, see compactNames
+	vector<int> frameNumbers;
+	bool compactNames;				//paths are built from namePrefix, the frame number and nameSuffix
+	string namePrefix;
+	string nameSuffix;
+	int nameDigits;					//zero padding of the frame number, 0 for none
+	vector<pair<int, int> > frameGaps;
+	vector<int> duplicateFrameNumbers;
+	PixelLayout pixelLayout;
+	bool premultiplied;
+	bool alphaTrim;
+	vector<ofRectangle> trimRects;	//each frame's region of the full frame, empty until it's decoded
+	int untrimmedWidth;
+	int untrimmedHeight;
+	int deltaInterval;
+	vector<ofRectangle> deltaRects;	//what each frame changed from the one before, empty when nothing did
+	vector<bool> deltaPatches;		//true when a frame holds only its delta rect rather than the whole frame
+	ofPixels deltaCanvas;			//the last delta frame rebuilt, whole
+	int deltaCanvasFrame;
+	ofRectangle lastDirtyRect;
+	ofxImageSequenceManifest manifest;
+	bool useManifest;
+	bool loadedFromManifest;
+	bool manifestDirty;				//frames failed since the manifest was written
 	vector<bool> loadFailed;
+	ofxImageSequencePackedFile packedFile;
+	ofxImageSequenceRawFile rawFile;
+	list<int> cacheOrder;						//resident frames, most recently used first
+	vector<list<int>::iterator> cachePosition;	//each frame's place in cacheOrder, or cacheOrder.end() when not resident
+	uint64_t cacheBudgetBytes;
+	int cacheMaxFrames;
+	uint64_t cacheResidentBytes;
+	uint64_t cacheHits;
+	uint64_t cacheMisses;
+	uint64_t cacheEvictions;
+	vector<shared_ptr<CompressedFrame> > compressedFrames;
+	map<int, ofPixels> framesToCompress;	//decoded off the workers, waiting for a preload job to compress them
+	list<int> compressedOrder;		//frames in the compressed tier, most recently used first
+	vector<list<int>::iterator> compressedPosition;
+	uint64_t compressedBudgetBytes;
+	uint64_t compressedResidentBytes;
+	uint64_t compressedSourceBytes;
+	uint64_t compressedHits;
+	bool streaming;
+	int streamingBehind;
+	int streamingAhead;
+	int savedCacheMaxFrames;			//settings streaming took over, put back by disableStreaming
+	bool savedPrefetchEnabled;
+	int savedPrefetchWindow;
+	ofxImageSequencePixelPool pixelPool;		//buffers of evicted frames, reused by the next decode
+	ofxImageSequenceStats stats;
+
+	bool asyncFrames;
+	int requestedFrame;				//frame a non-blocking setFrame is waiting on, -1 if none
+	bool listeningToUpdate;
+	bool prefetchEnabled;
+	int prefetchWindow;
+	deque<int> playheadHistory;
+	int playheadStep;
+	bool playheadPingPong;
+	bool playheadScrubbing;
 	int currentFrame;
 	ofTexture texture;
+	ofPixels emptyPixels;
 	string extension;
 	
 	string folderToLoad;
-	int curLoadFrame;
+	int nextPreloadFrame;
+	int framesPreloaded;
+	bool preloading;				//preload frames are being handed out
+	int preloadJobsRunning;
+	bool loadCancelled;				//a threaded load was stopped partway and can be resumed
+	int numLoadThreads;
+	LoadThrottle loadThrottle;
+	float loadThrottleAmount;
+	uint64_t nextThrottleSlot;		//no preload job starts before this ofGetElapsedTimeMicros time
 	int maxFrames;
+	int frameRangeFirst;
+	int frameRangeLast;				//-1 for the end of the sequence
+	int frameStride;
+	int loadRangeFirst;				//range and stride of the load in progress, from the settings above or a loadSequence overload
+	int loadRangeLast;
+	int loadStride;
+	int sourceFirst;				//range and stride the loaded frames were picked with
+	int sourceStride;
 	bool useThread;
+	bool lazyOpen;
+	bool useSharedCache;
+	bool useTexture;
 	bool loaded;
 
 	float width, height;
+	int numChannels;
 	int lastFrameLoaded;
 	float frameRate;
 	
@@ -0,0 +1,218 @@
+/**
+ *  ofxImageSequenceCodec.cpp
+ *
+ *  see ofxImageSequenceCodec.h for the block layout
+ */
+
+#include "ofxImageSequenceCodec.h"
+
+static const int minMatch = 4;
+static const int hashBits = 16;
+static const size_t maxDistance = 65535;
+
+static inline uint32_t read32(const unsigned char* p)
+{
+	uint32_t value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+static inline uint32_t hash32(uint32_t value)
+{
+	return (value * 2654435761u) >> (32 - hashBits);
+}
+
+//writes the part of a length that didn't fit in its nibble
+static inline unsigned char* writeLength(unsigned char* out, size_t length)
+{
+	while(length >= 255){
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = length;
+	return out;
+}
+
+static inline bool readLength(const unsigned char* src, size_t srcSize, size_t& position, size_t& length)
+{
+	unsigned char byte;
+	do{
+		if(position >= srcSize){
+			return false;
+		}
+		byte = src[position++];
+		length += byte;
+	} while(byte == 255);
+	return true;
+}
+
+size_t ofxImageSequenceCodec::compress(const unsigned char* src, size_t size, vector<unsigned char>& dst)
+{
+	//the worst case only matters until it's clear the output won't be smaller, so the input size plus room for one sequence is enough
+	dst.resize(size + 16);
+	unsigned char* out = &dst[0];
+	unsigned char* outLimit = out + size;
+
+	//one table per thread, kept between calls rather than allocated and cleared for every frame. entries left over
+	//from earlier input are harmless: a candidate only counts if it's behind us and its bytes match this input
+	static thread_local vector<uint32_t> table;
+	if(table.empty()){
+		table.resize(1 << hashBits, 0);
+	}
+	size_t anchor = 0;
+	size_t position = 1;
+	int misses = 0;
+
+	while(size >= minMatch && position + minMatch <= size){
+		uint32_t value = read32(src + position);
+		uint32_t& slot = table[hash32(value)];
+		size_t candidate = slot;
+		slot = position;
+
+		if(candidate >= position || position - candidate > maxDistance || read32(src + candidate) != value){
+			//skip ahead faster the longer nothing matches, incompressible data costs little that way
+			position += 1 + (misses++ >> 6);
+			continue;
+		}
+		misses = 0;
+
+		//eight bytes at a time until they differ, then find which one did
+		size_t length = minMatch;
+		while(position + length + 8 <= size && memcmp(src + candidate + length, src + position + length, 8) == 0){
+			length += 8;
+		}
+		while(position + length < size && src[candidate + length] == src[position + length]){
+			length++;
+		}
+
+		size_t literals = position - anchor;
+		if(out + 1 + literals / 255 + 1 + literals + 2 + length / 255 + 1 > outLimit){
+			dst.clear();
+			return 0;
+		}
+
+		unsigned char* token = out++;
+		*token = MIN(literals, (size_t)15) << 4;
+		if(literals >= 15){
+			out = writeLength(out, literals - 15);
+		}
+		memcpy(out, src + anchor, literals);
+		out += literals;
+
+		size_t distance = position - candidate;
+		*out++ = distance & 0xFF;
+		*out++ = distance >> 8;
+		size_t matchLength = length - minMatch;
+		*token |= MIN(matchLength, (size_t)15);
+		if(matchLength >= 15){
+			out = writeLength(out, matchLength - 15);
+		}
+
+		position += length;
+		anchor = position;
+		//seed the table inside the match too, runs of pixels often repeat at the next position over
+		if(position - 2 > candidate && position + minMatch <= size){
+			table[hash32(read32(src + position - 2))] = position - 2;
+		}
+	}
+
+	size_t literals = size - anchor;
+	if(out + 1 + literals / 255 + 1 + literals > outLimit){
+		dst.clear();
+		return 0;
+	}
+	unsigned char* token = out++;
+	*token = MIN(literals, (size_t)15) << 4;
+	if(literals >= 15){
+		out = writeLength(out, literals - 15);
+	}
+	memcpy(out, src + anchor, literals);
+	out += literals;
+
+	size_t compressedSize = out - &dst[0];
+	dst.resize(compressedSize);
+	return compressedSize;
+}
+
+bool ofxImageSequenceCodec::decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+{
+	size_t in = 0;
+	size_t out = 0;
+	while(true){
+		//only a literals only sequence may end the block, running out after a match means it was cut short
+		if(in >= srcSize){
+			return false;
+		}
+		unsigned char token = src[in++];
+
+		size_t literals = token >> 4;
+		if(literals == 15 && !readLength(src, srcSize, in, literals)){
+			return false;
+		}
+		if(literals > srcSize - in || literals > dstSize - out){
+			return false;
+		}
+		//short runs are copied as a fixed 16 bytes when there's room, the spare bytes get written over later
+		if(literals <= 16 && srcSize - in >= 16 && dstSize - out >= 16){
+			memcpy(dst + out, src + in, 16);
+		}
+		else{
+			memcpy(dst + out, src + in, literals);
+		}
+		in += literals;
+		out += literals;
+
+		if(in == srcSize){
+			break;
+		}
+
+		if(srcSize - in < 2){
+			return false;
+		}
+		size_t distance = src[in] | (src[in + 1] << 8);
+		in += 2;
+		if(distance == 0 || distance > out){
+			return false;
+		}
+
+		size_t length = token & 0x0F;
+		if(length == 15 && !readLength(src, srcSize, in, length)){
+			return false;
+		}
+		length += minMatch;
+		if(length > dstSize - out){
+			return false;
+		}
+
+		unsigned char* to = dst + out;
+		const unsigned char* from = to - distance;
+		if(distance >= 16 && dstSize - out >= length + 16){
+			for(size_t copied = 0; copied < length; copied += 16){
+				memcpy(to + copied, from + copied, 16);
+			}
+		}
+		else if(dstSize - out >= length + 32){
+			//a short distance repeats a short pattern, lay it down bytewise up to a multiple of the distance that's at
+			//least 16 long and the rest can be copied 16 bytes at a time from that far back
+			size_t period = distance * ((16 + distance - 1) / distance);
+			size_t head = MIN(length, period);
+			for(size_t i = 0; i < head; i++){
+				to[i] = from[i];
+			}
+			for(size_t copied = head; copied < length; copied += 16){
+				memcpy(to + copied, to + copied - period, 16);
+			}
+		}
+		else{
+			//overlapping matches repeat the last distance bytes, copy in doubling chunks that never overlap what they read
+			size_t copied = 0;
+			while(copied < length){
+				size_t chunk = MIN(length - copied, distance + copied);
+				memcpy(to + copied, from, chunk);
+				copied += chunk;
+			}
+		}
+		out += length;
+	}
+	return out == dstSize;
+}
@@ -0,0 +1,32 @@
+/**
+ *  ofxImageSequenceCodec.h
+ *
+ *  A small lossless LZ77 codec in the style of LZ4, for keeping decoded frames in memory at a
+ *  fraction of their size and getting them back far faster than decoding the original file.
+ *  It favours speed over ratio: a single hash probe per position, no entropy coding.
+ *
+ *  A block is a run of sequences, each one:
+ *
+ *	token	uint8    high nibble literal count, low nibble match length - 4. 15 means more follows
+ *			uint8... when the literal count is 15, bytes added to it until one is less than 255
+ *	literals
+ *			uint16   little endian distance back to the match, from 1 to 65535
+ *			uint8... when the match length is 15, bytes added to it until one is less than 255
+ *
+ *  The last sequence has only literals and ends the block.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceCodec {
+  public:
+
+	//compresses size bytes of src into dst, replacing its contents. returns the compressed size,
+	//or 0 if it wouldn't come out smaller than the input in which case dst is left empty
+	static size_t compress(const unsigned char* src, size_t size, vector<unsigned char>& dst);
+
+	//fills exactly dstSize bytes of dst from a compressed block. returns false on corrupt or mismatched input
+	static bool decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
+};
@@ -0,0 +1,287 @@
+/**
+ *  ofxImageSequenceManifest.cpp
+ *
+ *  see ofxImageSequenceManifest.h for the file layout
+ */
+
+#include "ofxImageSequenceManifest.h"
+#include <sys/stat.h>
+
+static const char manifestMagic[8] = {'O','F','X','I','S','E','Q','M'};
+static const uint32_t manifestVersion = 2;
+
+static void writeUInt32(ostream& out, uint32_t value)
+{
+	unsigned char bytes[4];
+	for(int i = 0; i < 4; i++){
+		bytes[i] = (value >> (i * 8)) & 0xFF;
+	}
+	out.write((char*)bytes, 4);
+}
+
+static void writeUInt64(ostream& out, uint64_t value)
+{
+	writeUInt32(out, value & 0xFFFFFFFF);
+	writeUInt32(out, value >> 32);
+}
+
+static void writeString(ostream& out, const string& value)
+{
+	writeUInt32(out, value.size());
+	out.write(value.c_str(), value.size());
+}
+
+//reads from a loaded manifest, every read after running off the end fails
+class ofxImageSequenceManifestReader {
+  public:
+	const unsigned char* bytes;
+	size_t size;
+	size_t position;
+
+	ofxImageSequenceManifestReader(const ofBuffer& buffer)
+	: bytes((const unsigned char*)buffer.getData())
+	, size(buffer.size())
+	, position(0)
+	{
+	}
+
+	bool read(size_t length){
+		if(position + length > size){
+			position = size + 1;
+			return false;
+		}
+		position += length;
+		return true;
+	}
+
+	bool good(){
+		return position <= size;
+	}
+
+	uint32_t readUInt32(){
+		if(!read(4)){
+			return 0;
+		}
+		const unsigned char* at = bytes + position - 4;
+		return at[0] | (at[1] << 8) | (at[2] << 16) | ((uint32_t)at[3] << 24);
+	}
+
+	uint64_t readUInt64(){
+		uint64_t low = readUInt32();
+		return low | ((uint64_t)readUInt32() << 32);
+	}
+
+	unsigned char readByte(){
+		return read(1) ? bytes[position - 1] : 0;
+	}
+
+	string readString(){
+		uint32_t length = readUInt32();
+		if(!read(length)){
+			return "";
+		}
+		return string((const char*)bytes + position - length, length);
+	}
+};
+
+ofxImageSequenceManifest::ofxImageSequenceManifest()
+{
+	clear();
+}
+
+string ofxImageSequenceManifest::getPathForFolder(string folder)
+{
+	return ofFilePath::removeTrailingSlash(folder) + ".manifest";
+}
+
+bool ofxImageSequenceManifest::getFileStats(string path, uint64_t& size, uint64_t& modified)
+{
+	struct stat info;
+	if(stat(ofToDataPath(path).c_str(), &info) != 0){
+		return false;
+	}
+	size = info.st_size;
+	modified = info.st_mtime;
+	return true;
+}
+
+void ofxImageSequenceManifest::clear()
+{
+	folderModified = 0;
+	extension = "";
+	maxFrames = 0;
+	rangeFirst = 0;
+	rangeLast = -1;
+	stride = 1;
+	width = 0;
+	height = 0;
+	channels = 0;
+	compactNames = false;
+	namePrefix = "";
+	nameSuffix = "";
+	nameDigits = 0;
+	frames.clear();
+	frameGaps.clear();
+	duplicateFrameNumbers.clear();
+}
+
+bool ofxImageSequenceManifest::load(string path)
+{
+	clear();
+
+	if(!ofFile(path).exists()){
+		return false;
+	}
+
+	ofBuffer buffer = ofBufferFromFile(path, true);
+	if(buffer.size() < 12 || memcmp(buffer.getData(), manifestMagic, 8) != 0){
+		ofLogWarning("ofxImageSequenceManifest::load") << path << " is not a sequence manifest";
+		return false;
+	}
+
+	ofxImageSequenceManifestReader reader(buffer);
+	reader.read(8);
+	if(reader.readUInt32() != manifestVersion){
+		ofLogWarning("ofxImageSequenceManifest::load") << path << " was written by a different version, ignoring it";
+		return false;
+	}
+
+	folderModified = reader.readUInt64();
+	maxFrames = (int32_t)reader.readUInt32();
+	rangeFirst = (int32_t)reader.readUInt32();
+	rangeLast = (int32_t)reader.readUInt32();
+	stride = (int32_t)reader.readUInt32();
+	extension = reader.readString();
+	width = reader.readUInt32();
+	height = reader.readUInt32();
+	channels = reader.readUInt32();
+	uint32_t numFrames = reader.readUInt32();
+	compactNames = reader.readByte() != 0;
+	namePrefix = reader.readString();
+	nameSuffix = reader.readString();
+	nameDigits = reader.readUInt32();
+
+	uint32_t numGaps = reader.readUInt32();
+	for(uint32_t i = 0; i < numGaps && reader.good(); i++){
+		int first = (int32_t)reader.readUInt32();
+		int count = (int32_t)reader.readUInt32();
+		frameGaps.push_back(make_pair(first, count));
+	}
+	uint32_t numDuplicates = reader.readUInt32();
+	for(uint32_t i = 0; i < numDuplicates && reader.good(); i++){
+		duplicateFrameNumbers.push_back((int32_t)reader.readUInt32());
+	}
+
+	//each frame takes at least 21 bytes, don't trust a count the file can't hold. folder scans never pad past 9 digits
+	if(!reader.good() || numFrames == 0 || numFrames > (buffer.size() - reader.position) / 21 || nameDigits < 0 || nameDigits > 9){
+		ofLogWarning("ofxImageSequenceManifest::load") << path << " is truncated, ignoring it";
+		clear();
+		return false;
+	}
+
+	frames.resize(numFrames);
+	for(uint32_t i = 0; i < numFrames; i++){
+		Frame& frame = frames[i];
+		frame.number = (int32_t)reader.readUInt32();
+		frame.size = reader.readUInt64();
+		frame.modified = reader.readUInt64();
+		frame.failed = reader.readByte() != 0;
+		if(!compactNames){
+			frame.name = reader.readString();
+		}
+	}
+
+	if(!reader.good()){
+		ofLogWarning("ofxImageSequenceManifest::load") << path << " is truncated, ignoring it";
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool ofxImageSequenceManifest::save(string path)
+{
+	ofstream out(ofToDataPath(path).c_str(), ios::binary | ios::trunc);
+	if(!out.is_open()){
+		ofLogWarning("ofxImageSequenceManifest::save") << "Could not open " << path << " for writing";
+		return false;
+	}
+
+	out.write(manifestMagic, 8);
+	writeUInt32(out, manifestVersion);
+	writeUInt64(out, folderModified);
+	writeUInt32(out, maxFrames);
+	writeUInt32(out, rangeFirst);
+	writeUInt32(out, rangeLast);
+	writeUInt32(out, stride);
+	writeString(out, extension);
+	writeUInt32(out, width);
+	writeUInt32(out, height);
+	writeUInt32(out, channels);
+	writeUInt32(out, frames.size());
+	out.put(compactNames ? 1 : 0);
+	writeString(out, namePrefix);
+	writeString(out, nameSuffix);
+	writeUInt32(out, nameDigits);
+
+	writeUInt32(out, frameGaps.size());
+	for(int i = 0; i < frameGaps.size(); i++){
+		writeUInt32(out, frameGaps[i].first);
+		writeUInt32(out, frameGaps[i].second);
+	}
+	writeUInt32(out, duplicateFrameNumbers.size());
+	for(int i = 0; i < duplicateFrameNumbers.size(); i++){
+		writeUInt32(out, duplicateFrameNumbers[i]);
+	}
+
+	for(int i = 0; i < frames.size(); i++){
+		const Frame& frame = frames[i];
+		writeUInt32(out, frame.number);
+		writeUInt64(out, frame.size);
+		writeUInt64(out, frame.modified);
+		out.put(frame.failed ? 1 : 0);
+		if(!compactNames){
+			writeString(out, frame.name);
+		}
+	}
+
+	if(!out.good()){
+		ofLogWarning("ofxImageSequenceManifest::save") << "Failed writing " << path;
+		return false;
+	}
+	return true;
+}
+
+bool ofxImageSequenceManifest::matches(string folder, string _extension, int _maxFrames, int _rangeFirst, int _rangeLast, int _stride)
+{
+	if(frames.size() == 0 || extension != _extension || maxFrames != _maxFrames ||
+	   rangeFirst != _rangeFirst || rangeLast != _rangeLast || stride != _stride){
+		return false;
+	}
+
+	uint64_t size, modified;
+	if(!getFileStats(folder, size, modified) || modified != folderModified){
+		return false;
+	}
+
+	//files rewritten in place don't touch the folder, the ends of the sequence are the usual suspects
+	int ends[2] = {0, (int)frames.size() - 1};
+	for(int i = 0; i < 2; i++){
+		const Frame& frame = frames[ends[i]];
+		if(!getFileStats(getFramePath(folder, ends[i]), size, modified) || size != frame.size || modified != frame.modified){
+			return false;
+		}
+	}
+	return true;
+}
+
+string ofxImageSequenceManifest::getFramePath(string folder, int index)
+{
+	folder = ofFilePath::addTrailingSlash(folder);
+	if(!compactNames){
+		return folder + frames[index].name;
+	}
+	char number[16];
+	snprintf(number, sizeof(number), "%0*d", nameDigits, frames[index].number);
+	return folder + namePrefix + number + nameSuffix;
+}
@@ -0,0 +1,74 @@
+/**
+ *  ofxImageSequenceManifest.h
+ *
+ *  Remembers what loading a folder found, so the next load of the same folder can skip the
+ *  directory scan and the first frame's decode. It's written beside the folder rather than
+ *  inside it so writing it doesn't change the folder's modification time.
+ *
+ *  A manifest is only trusted while the folder's modification time and the size and time of
+ *  its first and last frames still match. Adding, removing or renaming files changes the
+ *  folder's time.
+ *
+ *  Layout, all integers little endian, strings are a uint32 length followed by the bytes:
+ *
+ *	header	char[8]  magic "OFXISEQM"
+ *			uint32   version
+ *			uint64   modification time of the folder
+ *			int32    frame limit the folder was scanned with
+ *			int32    first and last frame of the range and the stride it was scanned with, last is -1 for the end
+ *			string   extension the folder was scanned with
+ *			uint32   width, height and channels, 0 if unknown
+ *			uint32   number of frames
+ *			uint8    1 if the names share a pattern, name prefix + number + name suffix
+ *			string   name prefix, string name suffix, uint32 zero padding of the number
+ *			uint32   number of gaps, then int32 first missing number and int32 count for each
+ *			uint32   number of duplicates, then int32 number for each
+ *	frames	int32 number, uint64 size, uint64 modification time, uint8 1 if it failed to load,
+ *			followed by its file name when the names don't share a pattern
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceManifest {
+  public:
+
+	struct Frame {
+		string name;		//empty when the names share a pattern
+		int number;
+		uint64_t size;
+		uint64_t modified;
+		bool failed;
+	};
+
+	ofxImageSequenceManifest();
+
+	static string getPathForFolder(string folder);
+	static bool getFileStats(string path, uint64_t& size, uint64_t& modified);
+
+	bool load(string path);
+	bool save(string path);
+	void clear();
+
+	//true when the manifest was written for this folder with these settings and it hasn't changed since
+	bool matches(string folder, string extension, int maxFrames, int rangeFirst = 0, int rangeLast = -1, int stride = 1);
+	string getFramePath(string folder, int index);
+
+	uint64_t folderModified;
+	string extension;
+	int maxFrames;
+	int rangeFirst;
+	int rangeLast;
+	int stride;
+	int width;
+	int height;
+	int channels;
+	bool compactNames;
+	string namePrefix;		//relative to the folder
+	string nameSuffix;
+	int nameDigits;
+	vector<Frame> frames;
+	vector<pair<int, int> > frameGaps;
+	vector<int> duplicateFrameNumbers;
+};
@@ -0,0 +1,257 @@
+/**
+ *  ofxImageSequencePackedFile.cpp
+ *
+ *  see ofxImageSequencePackedFile.h for the file layout
+ */
+
+#include "ofxImageSequencePackedFile.h"
+
+static const char packedMagic[8] = {'O','F','X','I','S','E','Q','P'};
+static const uint32_t packedVersion = 1;
+static const int packedHeaderSize = 8 + 4 * 5;
+static const int packedEntrySize = 8 + 8 + 4 + 4;
+
+static void writeUInt32(ostream& out, uint32_t value)
+{
+	unsigned char bytes[4];
+	for(int i = 0; i < 4; i++){
+		bytes[i] = (value >> (i * 8)) & 0xFF;
+	}
+	out.write((char*)bytes, 4);
+}
+
+static void writeUInt64(ostream& out, uint64_t value)
+{
+	writeUInt32(out, value & 0xFFFFFFFF);
+	writeUInt32(out, value >> 32);
+}
+
+static uint32_t readUInt32(const unsigned char* bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t readUInt64(const unsigned char* bytes)
+{
+	return readUInt32(bytes) | ((uint64_t)readUInt32(bytes + 4) << 32);
+}
+
+ofxImageSequencePackedFile::ofxImageSequencePackedFile()
+{
+	width = 0;
+	height = 0;
+	channels = 0;
+}
+
+ofxImageSequencePackedFile::~ofxImageSequencePackedFile()
+{
+	close();
+}
+
+bool ofxImageSequencePackedFile::write(const vector<string>& filenames, string packedPath)
+{
+	if(filenames.size() == 0){
+		ofLogError("ofxImageSequencePackedFile::write") << "No frames to pack";
+		return false;
+	}
+
+	ofPixels firstFrame;
+	if(!ofLoadImage(firstFrame, filenames[0])){
+		ofLogError("ofxImageSequencePackedFile::write") << "Could not load first frame " << filenames[0];
+		return false;
+	}
+
+	ofstream out(ofToDataPath(packedPath).c_str(), ios::binary | ios::trunc);
+	if(!out.is_open()){
+		ofLogError("ofxImageSequencePackedFile::write") << "Could not open " << packedPath << " for writing";
+		return false;
+	}
+
+	out.write(packedMagic, 8);
+	writeUInt32(out, packedVersion);
+	writeUInt32(out, filenames.size());
+	writeUInt32(out, firstFrame.getWidth());
+	writeUInt32(out, firstFrame.getHeight());
+	writeUInt32(out, firstFrame.getNumChannels());
+
+	//leave room for the index and fill it in once the frame sizes are known
+	uint64_t indexStart = out.tellp();
+	vector<char> emptyIndex(packedEntrySize * filenames.size(), 0);
+	out.write(&emptyIndex[0], emptyIndex.size());
+
+	vector<Entry> written;
+	for(int i = 0; i < filenames.size(); i++){
+		ofBuffer data = ofBufferFromFile(filenames[i], true);
+		if(data.size() == 0){
+			ofLogError("ofxImageSequencePackedFile::write") << "Could not read " << filenames[i];
+		}
+
+		Entry entry;
+		entry.offset = out.tellp();
+		entry.size = data.size();
+		entry.format = ofToLower(ofFilePath::getFileExt(filenames[i]));
+		entry.format.resize(4, ' ');
+		out.write(data.getData(), data.size());
+		written.push_back(entry);
+	}
+
+	out.seekp(indexStart);
+	for(int i = 0; i < written.size(); i++){
+		writeUInt64(out, written[i].offset);
+		writeUInt64(out, written[i].size);
+		out.write(written[i].format.c_str(), 4);
+		writeUInt32(out, 0);
+	}
+
+	if(!out.good()){
+		ofLogError("ofxImageSequencePackedFile::write") << "Failed writing " << packedPath;
+		return false;
+	}
+	return true;
+}
+
+bool ofxImageSequencePackedFile::isPackedFile(string path)
+{
+	ifstream in(ofToDataPath(path).c_str(), ios::binary);
+	char magic[8];
+	if(!in.read(magic, 8)){
+		return false;
+	}
+	return memcmp(magic, packedMagic, 8) == 0;
+}
+
+bool ofxImageSequencePackedFile::open(string _path)
+{
+	close();
+
+	file.open(ofToDataPath(_path).c_str(), ios::binary);
+	if(!file.is_open()){
+		ofLogError("ofxImageSequencePackedFile::open") << "Could not open " << _path;
+		return false;
+	}
+
+	unsigned char header[packedHeaderSize];
+	if(!file.read((char*)header, packedHeaderSize) || memcmp(header, packedMagic, 8) != 0){
+		ofLogError("ofxImageSequencePackedFile::open") << _path << " is not a packed image sequence";
+		close();
+		return false;
+	}
+
+	uint32_t version = readUInt32(header + 8);
+	if(version != packedVersion){
+		ofLogError("ofxImageSequencePackedFile::open") << _path << " has unsupported version " << version;
+		close();
+		return false;
+	}
+
+	uint32_t numFrames = readUInt32(header + 12);
+	width = readUInt32(header + 16);
+	height = readUInt32(header + 20);
+	channels = readUInt32(header + 24);
+
+	//don't trust a count the file can't hold, the index is sized from it before anything is read
+	file.seekg(0, ios::end);
+	uint64_t fileSize = file.tellg();
+	file.seekg(packedHeaderSize);
+	if(numFrames > (fileSize - packedHeaderSize) / packedEntrySize){
+		ofLogError("ofxImageSequencePackedFile::open") << _path << " has a truncated index";
+		close();
+		return false;
+	}
+
+	uint64_t dataStart = packedHeaderSize + (uint64_t)packedEntrySize * numFrames;
+	vector<unsigned char> index((size_t)packedEntrySize * numFrames);
+	if(numFrames > 0 && !file.read((char*)&index[0], index.size())){
+		ofLogError("ofxImageSequencePackedFile::open") << _path << " has a truncated index";
+		close();
+		return false;
+	}
+
+	entries.resize(numFrames);
+	for(int i = 0; i < numFrames; i++){
+		const unsigned char* bytes = &index[i * packedEntrySize];
+		entries[i].offset = readUInt64(bytes);
+		entries[i].size = readUInt64(bytes + 8);
+		entries[i].format = string((const char*)bytes + 16, 4);
+		entries[i].format.erase(entries[i].format.find_last_not_of(' ') + 1);
+
+		//readFrame allocates whatever size says, so every frame has to lie inside the data after the index
+		if(entries[i].offset < dataStart || entries[i].offset > fileSize || entries[i].size > fileSize - entries[i].offset){
+			ofLogError("ofxImageSequencePackedFile::open") << _path << " has frame " << i << " outside the file";
+			close();
+			return false;
+		}
+	}
+
+	path = _path;
+	return true;
+}
+
+void ofxImageSequencePackedFile::close()
+{
+	ofScopedLock lock(fileMutex);
+	if(file.is_open()){
+		file.close();
+	}
+	file.clear();
+	entries.clear();
+	path = "";
+	width = 0;
+	height = 0;
+	channels = 0;
+}
+
+bool ofxImageSequencePackedFile::isOpen()
+{
+	return file.is_open();
+}
+
+int ofxImageSequencePackedFile::getNumFrames()
+{
+	return entries.size();
+}
+
+int ofxImageSequencePackedFile::getWidth()
+{
+	return width;
+}
+
+int ofxImageSequencePackedFile::getHeight()
+{
+	return height;
+}
+
+int ofxImageSequencePackedFile::getNumChannels()
+{
+	return channels;
+}
+
+const ofxImageSequencePackedFile::Entry& ofxImageSequencePackedFile::getEntry(int index)
+{
+	return entries[index];
+}
+
+string ofxImageSequencePackedFile::getPath()
+{
+	return path;
+}
+
+bool ofxImageSequencePackedFile::readFrame(int index, ofBuffer& buffer)
+{
+	if(index < 0 || index >= entries.size()){
+		ofLogError("ofxImageSequencePackedFile::readFrame") << "Frame out of bounds: " << index;
+		return false;
+	}
+
+	const Entry& entry = entries[index];
+	buffer.allocate(entry.size);
+
+	ofScopedLock lock(fileMutex);
+	file.clear();
+	file.seekg(entry.offset);
+	if(!file.read(buffer.getData(), entry.size)){
+		ofLogError("ofxImageSequencePackedFile::readFrame") << "Could not read frame " << index << " from " << path;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,64 @@
+/**
+ *  ofxImageSequencePackedFile.h
+ *
+ *  Reads and writes packed image sequences: a single file holding every frame of a sequence
+ *  so loading doesn't have to list a directory and open thousands of files.
+ *
+ *  Layout, all integers little endian:
+ *
+ *	header	char[8]  magic "OFXISEQP"
+ *			uint32   version
+ *			uint32   number of frames
+ *			uint32   width, height and channels of the first frame
+ *	index	one entry per frame
+ *			uint64   offset of the frame's data from the start of the file
+ *			uint64   size of the frame's data in bytes
+ *			char[4]  format of the data, the original file extension, eg "png " or "jpg "
+ *			uint32   reserved
+ *	data	the original encoded image files, back to back
+ *
+ *  The index has fixed size entries so frames can be found without reading anything but the index.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequencePackedFile {
+  public:
+
+	struct Entry {
+		uint64_t offset;
+		uint64_t size;
+		string format;
+	};
+
+	ofxImageSequencePackedFile();
+	~ofxImageSequencePackedFile();
+
+	//packs the listed image files, in order, into a single file at packedPath
+	static bool write(const vector<string>& filenames, string packedPath);
+	static bool isPackedFile(string path);	//checks for the packed header, without reading the index
+
+	bool open(string path);
+	void close();
+	bool isOpen();
+
+	int getNumFrames();
+	int getWidth();
+	int getHeight();
+	int getNumChannels();
+	const Entry& getEntry(int index);
+	string getPath();
+
+	bool readFrame(int index, ofBuffer& buffer); //reads a frame's encoded data, safe to call from several threads
+
+  protected:
+	ifstream file;
+	ofMutex fileMutex;
+	string path;
+	vector<Entry> entries;
+	int width;
+	int height;
+	int channels;
+};
@@ -0,0 +1,382 @@
+/**
+ *  ofxImageSequencePixelOps.cpp
+ */
+
+#include "ofxImageSequencePixelOps.h"
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define OFX_IMAGE_SEQUENCE_AVX2
+	#define OFX_IMAGE_SEQUENCE_SSSE3
+	#define OFX_IMAGE_SEQUENCE_SSE2
+#elif defined(__SSSE3__)
+	#include <tmmintrin.h>
+	#define OFX_IMAGE_SEQUENCE_SSSE3
+	#define OFX_IMAGE_SEQUENCE_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define OFX_IMAGE_SEQUENCE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define OFX_IMAGE_SEQUENCE_NEON
+#endif
+
+//color * alpha / 255, rounded to nearest. exact for every pair of 8 bit values
+static inline unsigned char multiplyAlpha(unsigned int color, unsigned int alpha)
+{
+	unsigned int product = color * alpha + 128;
+	return (product + (product >> 8)) >> 8;
+}
+
+#ifdef OFX_IMAGE_SEQUENCE_SSE2
+//swaps the first and third byte of every 32 bit pixel
+static inline __m128i swapRedBlue(__m128i pixels)
+{
+	__m128i alphaGreen = _mm_and_si128(pixels, _mm_set1_epi32(0xFF00FF00));
+	__m128i redBlue = _mm_and_si128(pixels, _mm_set1_epi32(0x00FF00FF));
+	redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+	return _mm_or_si128(alphaGreen, redBlue);
+}
+
+//two pixels widened to 16 bits a channel, alpha is multiplied by 255 so it comes out unchanged
+static inline __m128i premultiplyWide(__m128i pixels)
+{
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm_or_si128(_mm_and_si128(alpha, _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1)), _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+	__m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+static inline __m128i premultiply(__m128i pixels)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i low = premultiplyWide(_mm_unpacklo_epi8(pixels, zero));
+	__m128i high = premultiplyWide(_mm_unpackhi_epi8(pixels, zero));
+	return _mm_packus_epi16(low, high);
+}
+#endif
+
+#ifdef OFX_IMAGE_SEQUENCE_AVX2
+static inline __m256i swapRedBlue(__m256i pixels)
+{
+	__m256i alphaGreen = _mm256_and_si256(pixels, _mm256_set1_epi32(0xFF00FF00));
+	__m256i redBlue = _mm256_and_si256(pixels, _mm256_set1_epi32(0x00FF00FF));
+	redBlue = _mm256_or_si256(_mm256_slli_epi32(redBlue, 16), _mm256_srli_epi32(redBlue, 16));
+	return _mm256_or_si256(alphaGreen, redBlue);
+}
+
+static inline __m256i premultiplyWide(__m256i pixels)
+{
+	__m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm256_or_si256(_mm256_and_si256(alpha, _mm256_set1_epi64x(0x0000FFFFFFFFFFFFLL)), _mm256_set1_epi64x(0x00FF000000000000LL));
+	__m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+//unpack and pack both work within 128 bit lanes so the pixels come back in order
+static inline __m256i premultiply(__m256i pixels)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i low = premultiplyWide(_mm256_unpacklo_epi8(pixels, zero));
+	__m256i high = premultiplyWide(_mm256_unpackhi_epi8(pixels, zero));
+	return _mm256_packus_epi16(low, high);
+}
+#endif
+
+#ifdef OFX_IMAGE_SEQUENCE_NEON
+static inline uint8x16_t premultiply(uint8x16_t color, uint8x16_t alpha)
+{
+	uint16x8_t low = vmull_u8(vget_low_u8(color), vget_low_u8(alpha));
+	uint16x8_t high = vmull_u8(vget_high_u8(color), vget_high_u8(alpha));
+	return vcombine_u8(vraddhn_u16(low, vrshrq_n_u16(low, 8)), vraddhn_u16(high, vrshrq_n_u16(high, 8)));
+}
+#endif
+
+void ofxImageSequencePixelOps::rgbToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool bgra)
+{
+	size_t i = 0;
+
+#if defined(OFX_IMAGE_SEQUENCE_SSSE3)
+	//four pixels per shuffle, reading 16 bytes for the 12 used so stop while there are two pixels to spare
+	__m128i shuffle = bgra ?
+		_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+		_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	__m128i opaque = _mm_set1_epi32(0xFF000000);
+	for(; i + 6 <= numPixels; i += 4){
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 3));
+		_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), opaque));
+	}
+#elif defined(OFX_IMAGE_SEQUENCE_NEON)
+	uint8x16_t opaque = vdupq_n_u8(255);
+	for(; i + 16 <= numPixels; i += 16){
+		uint8x16x3_t in = vld3q_u8(src + i * 3);
+		uint8x16x4_t out;
+		out.val[0] = bgra ? in.val[2] : in.val[0];
+		out.val[1] = in.val[1];
+		out.val[2] = bgra ? in.val[0] : in.val[2];
+		out.val[3] = opaque;
+		vst4q_u8(dst + i * 4, out);
+	}
+#endif
+
+	int red = bgra ? 2 : 0;
+	int blue = bgra ? 0 : 2;
+	for(; i < numPixels; i++){
+		const unsigned char* in = src + i * 3;
+		unsigned char* out = dst + i * 4;
+		out[0] = in[red];
+		out[1] = in[1];
+		out[2] = in[blue];
+		out[3] = 255;
+	}
+}
+
+void ofxImageSequencePixelOps::rgbaToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool bgra, bool premultiply)
+{
+	if(!bgra && !premultiply){
+		if(src != dst){
+			memcpy(dst, src, numPixels * 4);
+		}
+		return;
+	}
+
+	size_t i = 0;
+
+#if defined(OFX_IMAGE_SEQUENCE_AVX2)
+	for(; i + 8 <= numPixels; i += 8){
+		__m256i pixels = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+		if(premultiply){
+			pixels = ::premultiply(pixels);
+		}
+		if(bgra){
+			pixels = swapRedBlue(pixels);
+		}
+		_mm256_storeu_si256((__m256i*)(dst + i * 4), pixels);
+	}
+#endif
+#if defined(OFX_IMAGE_SEQUENCE_SSE2)
+	for(; i + 4 <= numPixels; i += 4){
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 4));
+		if(premultiply){
+			pixels = ::premultiply(pixels);
+		}
+		if(bgra){
+			pixels = swapRedBlue(pixels);
+		}
+		_mm_storeu_si128((__m128i*)(dst + i * 4), pixels);
+	}
+#elif defined(OFX_IMAGE_SEQUENCE_NEON)
+	for(; i + 16 <= numPixels; i += 16){
+		uint8x16x4_t pixels = vld4q_u8(src + i * 4);
+		if(premultiply){
+			for(int c = 0; c < 3; c++){
+				pixels.val[c] = ::premultiply(pixels.val[c], pixels.val[3]);
+			}
+		}
+		if(bgra){
+			uint8x16_t red = pixels.val[0];
+			pixels.val[0] = pixels.val[2];
+			pixels.val[2] = red;
+		}
+		vst4q_u8(dst + i * 4, pixels);
+	}
+#endif
+
+	int red = bgra ? 2 : 0;
+	int blue = bgra ? 0 : 2;
+	for(; i < numPixels; i++){
+		const unsigned char* in = src + i * 4;
+		unsigned char* out = dst + i * 4;
+		unsigned char alpha = in[3];
+		unsigned char r = in[0];
+		unsigned char g = in[1];
+		unsigned char b = in[2];
+		if(premultiply){
+			r = multiplyAlpha(r, alpha);
+			g = multiplyAlpha(g, alpha);
+			b = multiplyAlpha(b, alpha);
+		}
+		out[red] = r;
+		out[1] = g;
+		out[blue] = b;
+		out[3] = alpha;
+	}
+}
+
+//gray files are rare enough in practice that they only get the scalar version
+void ofxImageSequencePixelOps::grayToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool hasAlpha, bool premultiply)
+{
+	int stride = hasAlpha ? 2 : 1;
+	for(size_t i = 0; i < numPixels; i++){
+		const unsigned char* in = src + i * stride;
+		unsigned char* out = dst + i * 4;
+		unsigned char alpha = hasAlpha ? in[1] : 255;
+		unsigned char gray = premultiply ? multiplyAlpha(in[0], alpha) : in[0];
+		out[0] = gray;
+		out[1] = gray;
+		out[2] = gray;
+		out[3] = alpha;
+	}
+}
+
+void ofxImageSequencePixelOps::convert(const ofPixels& src, ofPixels& dst, bool bgra, bool premultiply)
+{
+	size_t numPixels = src.getWidth() * src.getHeight();
+	int channels = src.getNumChannels();
+	bool inPlace = &src == &dst;
+	ofPixelFormat format = bgra ? OF_PIXELS_BGRA : OF_PIXELS_RGBA;
+
+	if(inPlace && (channels != 4 || src.getPixelFormat() != format)){
+		ofLogError("ofxImageSequencePixelOps::convert") << "Can only convert in place when the layout stays the same";
+		return;
+	}
+	if(!inPlace){
+		dst.allocate(src.getWidth(), src.getHeight(), format);
+	}
+
+	//anything not marked as BGR order is treated as RGB order, which is what ofLoadImage produces
+	bool swap = bgra != (src.getPixelFormat() == OF_PIXELS_BGRA || src.getPixelFormat() == OF_PIXELS_BGR);
+	switch(channels){
+		case 1:
+		case 2:
+			grayToRgba(src.getData(), dst.getData(), numPixels, channels == 2, premultiply);
+			break;
+		case 3:
+			rgbToRgba(src.getData(), dst.getData(), numPixels, swap);
+			break;
+		case 4:
+			rgbaToRgba(src.getData(), dst.getData(), numPixels, swap, premultiply);
+			break;
+		default:
+			ofLogError("ofxImageSequencePixelOps::convert") << "Can't convert pixels with " << channels << " channels";
+			break;
+	}
+}
+
+static bool isRowTransparent(const unsigned char* alpha, int width, int channels)
+{
+	for(int i = 0; i < width; i++){
+		if(alpha[i * channels] != 0){
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ofxImageSequencePixelOps::getAlphaBounds(const ofPixels& pixels, int& x, int& y, int& width, int& height)
+{
+	int frameWidth = pixels.getWidth();
+	int frameHeight = pixels.getHeight();
+	int channels = pixels.getNumChannels();
+	x = 0;
+	y = 0;
+	width = frameWidth;
+	height = frameHeight;
+	if(channels != 2 && channels != 4){
+		return true;
+	}
+
+	size_t stride = (size_t)frameWidth * channels;
+	const unsigned char* alpha = pixels.getData() + channels - 1;
+
+	int top = 0;
+	while(top < frameHeight && isRowTransparent(alpha + top * stride, frameWidth, channels)){
+		top++;
+	}
+	if(top == frameHeight){
+		return false;
+	}
+	int bottom = frameHeight - 1;
+	while(bottom > top && isRowTransparent(alpha + bottom * stride, frameWidth, channels)){
+		bottom--;
+	}
+
+	//each row only has to be searched up to the edges found so far
+	int left = frameWidth - 1;
+	int right = 0;
+	for(int row = top; row <= bottom; row++){
+		const unsigned char* rowAlpha = alpha + row * stride;
+		for(int i = 0; i < left; i++){
+			if(rowAlpha[i * channels] != 0){
+				left = i;
+				break;
+			}
+		}
+		for(int i = frameWidth - 1; i > right; i--){
+			if(rowAlpha[i * channels] != 0){
+				right = i;
+				break;
+			}
+		}
+	}
+
+	x = left;
+	y = top;
+	width = MAX(right - left + 1, 1);
+	height = bottom - top + 1;
+	return true;
+}
+
+bool ofxImageSequencePixelOps::getDifferenceBounds(const ofPixels& a, const ofPixels& b, int& x, int& y, int& width, int& height)
+{
+	int frameWidth = a.getWidth();
+	int frameHeight = a.getHeight();
+	int channels = a.getNumChannels();
+	size_t stride = (size_t)frameWidth * channels;
+	const unsigned char* dataA = a.getData();
+	const unsigned char* dataB = b.getData();
+
+	//whole rows first, memcmp is as fast as it gets for the common case of nothing changing
+	int top = 0;
+	while(top < frameHeight && memcmp(dataA + top * stride, dataB + top * stride, stride) == 0){
+		top++;
+	}
+	if(top == frameHeight){
+		return false;
+	}
+	int bottom = frameHeight - 1;
+	while(bottom > top && memcmp(dataA + bottom * stride, dataB + bottom * stride, stride) == 0){
+		bottom--;
+	}
+
+	//then bytes, each row only searched up to the edges found so far
+	int left = stride - 1;
+	int right = 0;
+	for(int row = top; row <= bottom; row++){
+		const unsigned char* rowA = dataA + row * stride;
+		const unsigned char* rowB = dataB + row * stride;
+		for(int i = 0; i < left; i++){
+			if(rowA[i] != rowB[i]){
+				left = i;
+				break;
+			}
+		}
+		for(int i = stride - 1; i > right; i--){
+			if(rowA[i] != rowB[i]){
+				right = i;
+				break;
+			}
+		}
+	}
+
+	x = left / channels;
+	y = top;
+	width = MAX(right / channels - x + 1, 1);
+	height = bottom - top + 1;
+	return true;
+}
+
+string ofxImageSequencePixelOps::getInstructionSet()
+{
+#if defined(OFX_IMAGE_SEQUENCE_AVX2)
+	return "avx2";
+#elif defined(OFX_IMAGE_SEQUENCE_SSSE3)
+	return "ssse3";
+#elif defined(OFX_IMAGE_SEQUENCE_SSE2)
+	return "sse2";
+#elif defined(OFX_IMAGE_SEQUENCE_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,38 @@
+/**
+ *  ofxImageSequencePixelOps.h
+ *
+ *  Converts decoded frames to a single four channel layout so every frame in a sequence
+ *  uploads with the same format, whatever mix of gray, RGB and RGBA files it was made from.
+ *
+ *  The kernels are picked at compile time from the instruction sets the build targets:
+ *  AVX2, SSSE3 or SSE2 on x86 and NEON on ARM, with a scalar version for everything else
+ *  and for the pixels left over at the end of a row of vectors. Enable -mavx2 or -mssse3
+ *  (/arch:AVX2 on Visual Studio) in the project to get the wider kernels.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequencePixelOps {
+  public:
+
+	//writes src into dst as RGBA, or BGRA when bgra is set, multiplying color by alpha when premultiply is set.
+	//dst is allocated to fit and may be src when src already has four channels and the layout doesn't change
+	static void convert(const ofPixels& src, ofPixels& dst, bool bgra, bool premultiply);
+
+	//the kernels behind convert, on tightly packed pixels. src and dst may be the same for the four channel ones
+	static void rgbToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool bgra);
+	static void rgbaToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool bgra, bool premultiply);
+	static void grayToRgba(const unsigned char* src, unsigned char* dst, size_t numPixels, bool hasAlpha, bool premultiply);
+
+	//the smallest rectangle holding every pixel with non-zero alpha. frames without alpha are entirely visible,
+	//returns false when every pixel is transparent
+	static bool getAlphaBounds(const ofPixels& pixels, int& x, int& y, int& width, int& height);
+
+	//the smallest rectangle holding every pixel that differs between two frames of the same size and layout,
+	//returns false when they're identical
+	static bool getDifferenceBounds(const ofPixels& a, const ofPixels& b, int& x, int& y, int& width, int& height);
+
+	static string getInstructionSet();	//"avx2", "ssse3", "sse2", "neon" or "scalar", whichever the kernels were built with
+};
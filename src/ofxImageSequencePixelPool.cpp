@@ -0,0 +1,80 @@
+/**
+ *  ofxImageSequencePixelPool.cpp
+ */
+
+#include "ofxImageSequencePixelPool.h"
+
+ofxImageSequencePixelPool::ofxImageSequencePixelPool()
+{
+	capacity = 8;
+	reuses = 0;
+	misses = 0;
+}
+
+void ofxImageSequencePixelPool::setCapacity(int numBuffers)
+{
+	ofScopedLock lock(mutex);
+	capacity = MAX(numBuffers, 0);
+	if(buffers.size() > capacity){
+		buffers.resize(capacity);
+	}
+}
+
+int ofxImageSequencePixelPool::getCapacity()
+{
+	ofScopedLock lock(mutex);
+	return capacity;
+}
+
+void ofxImageSequencePixelPool::acquire(ofPixels& pixels)
+{
+	ofScopedLock lock(mutex);
+	if(buffers.size() == 0){
+		misses++;
+		return;
+	}
+	pixels.swap(buffers.back());
+	buffers.pop_back();
+	reuses++;
+}
+
+void ofxImageSequencePixelPool::release(ofPixels& pixels)
+{
+	if(!pixels.isAllocated()){
+		return;
+	}
+
+	{
+		ofScopedLock lock(mutex);
+		if(buffers.size() < capacity){
+			buffers.push_back(ofPixels());
+			buffers.back().swap(pixels);
+			return;
+		}
+	}
+	pixels.clear();
+}
+
+void ofxImageSequencePixelPool::clear()
+{
+	ofScopedLock lock(mutex);
+	buffers.clear();
+}
+
+int ofxImageSequencePixelPool::getNumFree()
+{
+	ofScopedLock lock(mutex);
+	return buffers.size();
+}
+
+uint64_t ofxImageSequencePixelPool::getReuses()
+{
+	ofScopedLock lock(mutex);
+	return reuses;
+}
+
+uint64_t ofxImageSequencePixelPool::getMisses()
+{
+	ofScopedLock lock(mutex);
+	return misses;
+}
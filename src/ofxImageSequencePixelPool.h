@@ -0,0 +1,35 @@
+/**
+ *  ofxImageSequencePixelPool.h
+ *
+ *  Keeps the buffers of frames that are no longer needed so the next decode can write
+ *  into them instead of allocating. Every frame in a sequence is the same size, so once
+ *  playback reaches a steady state decoding stops touching the heap for pixel storage.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequencePixelPool {
+  public:
+
+	ofxImageSequencePixelPool();
+
+	void setCapacity(int numBuffers);	//most spare buffers kept, the rest are freed. default is 8
+	int getCapacity();
+
+	void acquire(ofPixels& pixels);	//swaps a spare buffer into pixels if there is one
+	void release(ofPixels& pixels);	//takes pixels' buffer, leaving pixels empty. only pass pixels that own their data
+	void clear();
+
+	int getNumFree();
+	uint64_t getReuses();			//acquires that got a spare buffer
+	uint64_t getMisses();			//acquires that found the pool empty and will allocate
+
+  protected:
+	ofMutex mutex;
+	vector<ofPixels> buffers;
+	int capacity;
+	uint64_t reuses;
+	uint64_t misses;
+};
@@ -0,0 +1,246 @@
+/**
+ *  ofxImageSequencePlayer.cpp
+ */
+
+#include "ofxImageSequencePlayer.h"
+
+//how far back to look for a decoded frame to show in place of a late one
+static const int maxDropSearch = 64;
+
+static double defaultClock()
+{
+	return ofGetElapsedTimeMicros() / 1000000.0;
+}
+
+ofxImageSequencePlayer::ofxImageSequencePlayer()
+{
+	sequence = NULL;
+	clock = defaultClock;
+	playing = false;
+	loopMode = LOOP_NORMAL;
+	latePolicy = LATE_DROP;
+	speed = 1.0;
+	anchorPosition = 0;
+	anchorTime = 0;
+	lastUpdateTime = 0;
+	targetFrame = 0;
+	droppedFrames = 0;
+	heldFrames = 0;
+}
+
+void ofxImageSequencePlayer::setSequence(ofxImageSequence* _sequence)
+{
+	sequence = _sequence;
+	setPosition(0);
+}
+
+ofxImageSequence* ofxImageSequencePlayer::getSequence()
+{
+	return sequence;
+}
+
+void ofxImageSequencePlayer::setClock(function<double()> _clock)
+{
+	double position = getPosition();
+	clock = _clock ? _clock : defaultClock;
+	setPosition(position);
+}
+
+void ofxImageSequencePlayer::play()
+{
+	if(playing){
+		return;
+	}
+	anchorTime = now();
+	lastUpdateTime = anchorTime;
+	playing = true;
+}
+
+void ofxImageSequencePlayer::pause()
+{
+	if(!playing){
+		return;
+	}
+	anchorPosition = getPosition();
+	playing = false;
+}
+
+void ofxImageSequencePlayer::stop()
+{
+	pause();
+	setPosition(0);
+}
+
+bool ofxImageSequencePlayer::isPlaying()
+{
+	return playing;
+}
+
+void ofxImageSequencePlayer::setLoopMode(LoopMode mode)
+{
+	loopMode = mode;
+}
+
+ofxImageSequencePlayer::LoopMode ofxImageSequencePlayer::getLoopMode()
+{
+	return loopMode;
+}
+
+void ofxImageSequencePlayer::setSpeed(float _speed)
+{
+	//re-anchor so changing speed doesn't jump
+	setPosition(getPosition());
+	speed = _speed;
+}
+
+float ofxImageSequencePlayer::getSpeed()
+{
+	return speed;
+}
+
+void ofxImageSequencePlayer::setLatePolicy(LatePolicy policy)
+{
+	latePolicy = policy;
+}
+
+ofxImageSequencePlayer::LatePolicy ofxImageSequencePlayer::getLatePolicy()
+{
+	return latePolicy;
+}
+
+void ofxImageSequencePlayer::setPosition(double seconds)
+{
+	anchorPosition = seconds;
+	anchorTime = now();
+	lastUpdateTime = anchorTime;
+}
+
+double ofxImageSequencePlayer::getPosition()
+{
+	if(!playing){
+		return anchorPosition;
+	}
+	return anchorPosition + (now() - anchorTime) * speed;
+}
+
+void ofxImageSequencePlayer::update()
+{
+	if(sequence == NULL || !sequence->isLoaded() || sequence->getTotalFrames() == 0){
+		return;
+	}
+
+	double time = now();
+	targetFrame = frameForPosition(getPosition());
+
+	if(loopMode == LOOP_NONE && playing){
+		int lastFrame = speed >= 0 ? sequence->getTotalFrames() - 1 : 0;
+		if(targetFrame == lastFrame){
+			pause();
+		}
+	}
+
+	int shownFrame = sequence->getDisplayedFrame();
+	if(targetFrame == shownFrame){
+		lastUpdateTime = time;
+		return;
+	}
+
+	if(sequence->isFrameReady(targetFrame)){
+		sequence->setFrame(targetFrame);
+		lastUpdateTime = time;
+		return;
+	}
+
+	sequence->requestFrame(targetFrame);
+
+	if(!playing || latePolicy == LATE_DROP){
+		int latest = findLatestReadyFrame(targetFrame);
+		if(latest >= 0 && latest != shownFrame){
+			sequence->setFrame(latest);
+		}
+		if(playing){
+			droppedFrames++;
+		}
+	}
+	else{
+		//push the anchor forward by the time that just passed so the media clock stands still
+		anchorTime += time - lastUpdateTime;
+		targetFrame = frameForPosition(getPosition());
+		heldFrames++;
+	}
+	lastUpdateTime = time;
+}
+
+int ofxImageSequencePlayer::getTargetFrame()
+{
+	return targetFrame;
+}
+
+bool ofxImageSequencePlayer::isLate()
+{
+	return sequence != NULL && sequence->getDisplayedFrame() != targetFrame;
+}
+
+uint64_t ofxImageSequencePlayer::getDroppedFrames()
+{
+	return droppedFrames;
+}
+
+uint64_t ofxImageSequencePlayer::getHeldFrames()
+{
+	return heldFrames;
+}
+
+void ofxImageSequencePlayer::resetCounters()
+{
+	droppedFrames = 0;
+	heldFrames = 0;
+}
+
+double ofxImageSequencePlayer::now()
+{
+	return clock();
+}
+
+int ofxImageSequencePlayer::frameForPosition(double position)
+{
+	int total = sequence->getTotalFrames();
+	int frame = floor(position * sequence->getFrameRate());
+
+	switch(loopMode){
+		case LOOP_NONE:
+			return ofClamp(frame, 0, total - 1);
+		case LOOP_PALINDROME: {
+			if(total == 1){
+				return 0;
+			}
+			int period = 2 * (total - 1);
+			frame = ((frame % period) + period) % period;
+			return frame < total ? frame : period - frame;
+		}
+		case LOOP_NORMAL:
+		default:
+			return ((frame % total) + total) % total;
+	}
+}
+
+//steps back from the target towards the frame on screen looking for the newest decoded frame. on a loop shorter
+//than the search it stops if it comes round to the target again, which isn't decoded either
+int ofxImageSequencePlayer::findLatestReadyFrame(int target)
+{
+	double position = getPosition();
+	double frameDuration = 1.0 / sequence->getFrameRate();
+	double direction = speed >= 0 ? -1 : 1;
+	int shownFrame = sequence->getDisplayedFrame();
+
+	for(int i = 1; i <= maxDropSearch; i++){
+		int frame = frameForPosition(position + direction * frameDuration * i);
+		if(frame == shownFrame || frame == target){
+			return -1;
+		}
+		if(sequence->isFrameReady(frame)){
+			return frame;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,90 @@
+/**
+ *  ofxImageSequencePlayer.h
+ *
+ *  Plays an ofxImageSequence locked to a clock. Each update works out which frame
+ *  should be on screen from the clock, the speed and the loop mode, and never waits
+ *  on the decoder: when the frame isn't ready yet the late policy decides whether to
+ *  drop to the latest frame that is, or to hold the current frame and let playback slip.
+ *
+ *	player.setSequence(&sequence);
+ *	player.setLoopMode(ofxImageSequencePlayer::LOOP_PALINDROME);
+ *	player.play();
+ *
+ *	//in update
+ *	player.update();
+ *	//in draw
+ *	sequence.getTexture().draw(0, 0);
+ */
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxImageSequence.h"
+
+class ofxImageSequencePlayer {
+  public:
+
+	enum LoopMode {
+		LOOP_NONE,			//stop on the last frame
+		LOOP_NORMAL,		//jump back to the first frame
+		LOOP_PALINDROME		//play back and forth
+	};
+
+	enum LatePolicy {
+		LATE_DROP,			//stay on time, showing the latest decoded frame until the right one arrives
+		LATE_HOLD			//hold the current frame and slip the clock until the next frame is decoded
+	};
+
+	ofxImageSequencePlayer();
+
+	void setSequence(ofxImageSequence* sequence);
+	ofxImageSequence* getSequence();
+
+	//the clock playback follows, in seconds. defaults to ofGetElapsedTimef, pass a
+	//timecode or audio clock to keep several outputs in sync
+	void setClock(function<double()> clock);
+
+	void play();
+	void pause();
+	void stop();					//pauses and returns to the start
+	bool isPlaying();
+
+	void setLoopMode(LoopMode mode);
+	LoopMode getLoopMode();
+	void setSpeed(float speed);		//rate multiplier, negative plays backwards. default is 1
+	float getSpeed();
+	void setLatePolicy(LatePolicy policy);
+	LatePolicy getLatePolicy();
+
+	void setPosition(double seconds);
+	double getPosition();			//media time in seconds, before looping is applied
+
+	void update();					//call once per frame from the thread that draws
+
+	int getTargetFrame();			//the frame the clock says should be on screen
+	bool isLate();					//true if the frame on screen isn't the target frame
+	uint64_t getDroppedFrames();	//updates that showed an older frame to stay on time
+	uint64_t getHeldFrames();		//updates that held the frame and slipped the clock
+	void resetCounters();
+
+  protected:
+	double now();
+	int frameForPosition(double position);
+	int findLatestReadyFrame(int target);
+
+	ofxImageSequence* sequence;
+	function<double()> clock;
+
+	bool playing;
+	LoopMode loopMode;
+	LatePolicy latePolicy;
+	float speed;
+
+	double anchorPosition;	//media position at anchorTime
+	double anchorTime;		//clock time playback was last re-anchored
+	double lastUpdateTime;
+
+	int targetFrame;
+	uint64_t droppedFrames;
+	uint64_t heldFrames;
+};
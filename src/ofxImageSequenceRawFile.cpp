@@ -0,0 +1,334 @@
+/**
+ *  ofxImageSequenceRawFile.cpp
+ *
+ *  see ofxImageSequenceRawFile.h for the file layout
+ */
+
+#include "ofxImageSequenceRawFile.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char rawMagic[8] = {'O','F','X','I','S','E','Q','R'};
+static const uint32_t rawVersion = 1;
+static const int rawHeaderSize = 8 + 4 * 7;
+static const uint64_t rawPageSize = 4096;
+
+static void writeUInt32(ostream& out, uint32_t value)
+{
+	unsigned char bytes[4];
+	for(int i = 0; i < 4; i++){
+		bytes[i] = (value >> (i * 8)) & 0xFF;
+	}
+	out.write((char*)bytes, 4);
+}
+
+static uint32_t readUInt32(const unsigned char* bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static ofPixelFormat formatForChannels(int channels)
+{
+	switch(channels){
+		case 1: return OF_PIXELS_GRAY;
+		case 2: return OF_PIXELS_GRAY_ALPHA;
+		case 3: return OF_PIXELS_RGB;
+		case 4: return OF_PIXELS_RGBA;
+		default: return OF_PIXELS_UNKNOWN;
+	}
+}
+
+//0 for the formats raw files can't hold
+static int channelsForFormat(ofPixelFormat format)
+{
+	switch(format){
+		case OF_PIXELS_GRAY: return 1;
+		case OF_PIXELS_GRAY_ALPHA: return 2;
+		case OF_PIXELS_RGB: case OF_PIXELS_BGR: return 3;
+		case OF_PIXELS_RGBA: case OF_PIXELS_BGRA: return 4;
+		default: return 0;
+	}
+}
+
+ofxImageSequenceRawFile::ofxImageSequenceRawFile()
+{
+	framesWritten = 0;
+	mapping = NULL;
+	mappingSize = 0;
+#ifdef TARGET_WIN32
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#else
+	fileDescriptor = -1;
+#endif
+	numFrames = 0;
+	width = 0;
+	height = 0;
+	channels = 0;
+	format = OF_PIXELS_UNKNOWN;
+	dataOffset = 0;
+}
+
+ofxImageSequenceRawFile::~ofxImageSequenceRawFile()
+{
+	close();
+	if(out.is_open()){
+		out.close();
+	}
+}
+
+bool ofxImageSequenceRawFile::create(string path, int _numFrames, int _width, int _height, int _channels, ofPixelFormat _format)
+{
+	ofPixelFormat f = _format == OF_PIXELS_UNKNOWN ? formatForChannels(_channels) : _format;
+	if(channelsForFormat(f) == 0 || channelsForFormat(f) != _channels){
+		ofLogError("ofxImageSequenceRawFile::create") << "Can't store " << _channels << " channel frames in pixel format " << f;
+		return false;
+	}
+
+	out.open(ofToDataPath(path).c_str(), ios::binary | ios::trunc);
+	if(!out.is_open()){
+		ofLogError("ofxImageSequenceRawFile::create") << "Could not open " << path << " for writing";
+		return false;
+	}
+
+	numFrames = _numFrames;
+	width = _width;
+	height = _height;
+	channels = _channels;
+	format = f;
+	framesWritten = 0;
+	dataOffset = ((rawHeaderSize + numFrames + rawPageSize - 1) / rawPageSize) * rawPageSize;
+
+	out.write(rawMagic, 8);
+	writeUInt32(out, rawVersion);
+	writeUInt32(out, numFrames);
+	writeUInt32(out, width);
+	writeUInt32(out, height);
+	writeUInt32(out, channels);
+	writeUInt32(out, format);
+	writeUInt32(out, dataOffset);
+
+	//flags are filled in as frames are appended
+	vector<char> padding(dataOffset - rawHeaderSize, 0);
+	out.write(&padding[0], padding.size());
+	return out.good();
+}
+
+bool ofxImageSequenceRawFile::appendFrame(const ofPixels& pixels)
+{
+	if(!out.is_open() || framesWritten >= numFrames){
+		ofLogError("ofxImageSequenceRawFile::appendFrame") << "Appending more frames than the file was created for";
+		return false;
+	}
+
+	uint64_t frameBytes = (uint64_t)width * height * channels;
+	bool valid = pixels.isAllocated()
+		&& pixels.getWidth() == width
+		&& pixels.getHeight() == height
+		&& pixels.getNumChannels() == channels
+		&& pixels.getPixelFormat() == format
+		&& pixels.getBytesPerChannel() == 1;
+
+	if(pixels.isAllocated() && !valid){
+		ofLogError("ofxImageSequenceRawFile::appendFrame") << "Frame " << framesWritten << " doesn't match the sequence format, writing it as failed";
+	}
+
+	out.seekp(dataOffset + frameBytes * framesWritten);
+	if(valid){
+		out.write((const char*)pixels.getData(), frameBytes);
+	}
+	else{
+		vector<char> empty(frameBytes, 0);
+		out.write(&empty[0], frameBytes);
+	}
+
+	char flag = valid ? 1 : 0;
+	out.seekp(rawHeaderSize + framesWritten);
+	out.write(&flag, 1);
+
+	framesWritten++;
+	return out.good();
+}
+
+bool ofxImageSequenceRawFile::finish()
+{
+	if(!out.is_open()){
+		return false;
+	}
+	bool success = out.good() && framesWritten == numFrames;
+	out.close();
+	if(!success){
+		ofLogError("ofxImageSequenceRawFile::finish") << "Only " << framesWritten << " of " << numFrames << " frames were written";
+	}
+	return success;
+}
+
+bool ofxImageSequenceRawFile::isRawFile(string path)
+{
+	ifstream in(ofToDataPath(path).c_str(), ios::binary);
+	char magic[8];
+	if(!in.read(magic, 8)){
+		return false;
+	}
+	return memcmp(magic, rawMagic, 8) == 0;
+}
+
+bool ofxImageSequenceRawFile::open(string path)
+{
+	close();
+
+	string fullPath = ofToDataPath(path);
+#ifdef TARGET_WIN32
+	HANDLE file = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		ofLogError("ofxImageSequenceRawFile::open") << "Could not open " << path;
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE map = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	void* view = map != NULL ? MapViewOfFile(map, FILE_MAP_COPY, 0, 0, 0) : NULL;
+	if(view == NULL){
+		ofLogError("ofxImageSequenceRawFile::open") << "Could not map " << path;
+		if(map != NULL){
+			CloseHandle(map);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = map;
+	mapping = (unsigned char*)view;
+	mappingSize = size.QuadPart;
+#else
+	int fd = ::open(fullPath.c_str(), O_RDONLY);
+	if(fd < 0){
+		ofLogError("ofxImageSequenceRawFile::open") << "Could not open " << path;
+		return false;
+	}
+	struct stat info;
+	fstat(fd, &info);
+	//private mapping so a consumer writing into a frame's pixels gets its own copy of the page instead of a crash
+	void* view = info.st_size > 0 ? mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	if(view == MAP_FAILED){
+		ofLogError("ofxImageSequenceRawFile::open") << "Could not map " << path;
+		::close(fd);
+		return false;
+	}
+	fileDescriptor = fd;
+	mapping = (unsigned char*)view;
+	mappingSize = info.st_size;
+#endif
+
+	if(mappingSize < rawHeaderSize || memcmp(mapping, rawMagic, 8) != 0 || readUInt32(mapping + 8) != rawVersion){
+		ofLogError("ofxImageSequenceRawFile::open") << path << " is not a raw image sequence";
+		close();
+		return false;
+	}
+
+	//frames are handed out as views straight into the mapping, so nothing in the header is trusted
+	//until it's clear every frame it describes lies inside the file
+	uint32_t frames = readUInt32(mapping + 12);
+	uint32_t w = readUInt32(mapping + 16);
+	uint32_t h = readUInt32(mapping + 20);
+	uint32_t c = readUInt32(mapping + 24);
+	ofPixelFormat f = (ofPixelFormat)readUInt32(mapping + 28);
+	uint64_t offset = readUInt32(mapping + 32);
+	if(w == 0 || h == 0 || channelsForFormat(f) == 0 || channelsForFormat(f) != c){
+		ofLogError("ofxImageSequenceRawFile::open") << path << " has an unsupported frame size or pixel format";
+		close();
+		return false;
+	}
+	//divided rather than multiplied, so a hostile header can't overflow its way past the check
+	if(offset < rawHeaderSize + (uint64_t)frames || offset > mappingSize || w > (mappingSize - offset) / h / c ||
+	   (frames > 0 && frames > (mappingSize - offset) / ((uint64_t)w * h * c))){
+		ofLogError("ofxImageSequenceRawFile::open") << path << " is truncated";
+		close();
+		return false;
+	}
+
+	numFrames = frames;
+	width = w;
+	height = h;
+	channels = c;
+	format = f;
+	dataOffset = offset;
+	return true;
+}
+
+void ofxImageSequenceRawFile::close()
+{
+#ifdef TARGET_WIN32
+	if(mapping != NULL){
+		UnmapViewOfFile(mapping);
+		CloseHandle((HANDLE)mappingHandle);
+		CloseHandle((HANDLE)fileHandle);
+	}
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#else
+	if(mapping != NULL){
+		munmap(mapping, mappingSize);
+		::close(fileDescriptor);
+	}
+	fileDescriptor = -1;
+#endif
+	mapping = NULL;
+	mappingSize = 0;
+	numFrames = 0;
+	width = 0;
+	height = 0;
+	channels = 0;
+	format = OF_PIXELS_UNKNOWN;
+	dataOffset = 0;
+}
+
+bool ofxImageSequenceRawFile::isOpen()
+{
+	return mapping != NULL;
+}
+
+int ofxImageSequenceRawFile::getNumFrames()
+{
+	return numFrames;
+}
+
+int ofxImageSequenceRawFile::getWidth()
+{
+	return width;
+}
+
+int ofxImageSequenceRawFile::getHeight()
+{
+	return height;
+}
+
+int ofxImageSequenceRawFile::getNumChannels()
+{
+	return channels;
+}
+
+ofPixelFormat ofxImageSequenceRawFile::getPixelFormat()
+{
+	return format;
+}
+
+bool ofxImageSequenceRawFile::isFrameValid(int index)
+{
+	return mapping != NULL && index >= 0 && index < numFrames && mapping[rawHeaderSize + index] != 0;
+}
+
+unsigned char* ofxImageSequenceRawFile::getFrameData(int index)
+{
+	if(mapping == NULL || index < 0 || index >= numFrames){
+		return NULL;
+	}
+	return mapping + dataOffset + (uint64_t)width * height * channels * index;
+}
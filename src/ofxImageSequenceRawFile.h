@@ -0,0 +1,69 @@
+/**
+ *  ofxImageSequenceRawFile.h
+ *
+ *  Reads and writes raw image sequences: every frame stored uncompressed at a fixed
+ *  stride so the file can be memory mapped and frames handed out without decoding or copying.
+ *  Trades disk space for CPU, the OS page cache does the caching.
+ *
+ *  Layout, all integers little endian:
+ *
+ *	header	char[8]  magic "OFXISEQR"
+ *			uint32   version
+ *			uint32   number of frames
+ *			uint32   width, height and channels of every frame
+ *			uint32   ofPixelFormat of every frame, so BGRA stays BGRA
+ *			uint32   offset of the first frame from the start of the file
+ *	flags	one byte per frame, 1 if the frame was written, 0 if it failed to load
+ *	data	frames of width * height * channels bytes, starting at a page aligned offset
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceRawFile {
+  public:
+
+	ofxImageSequenceRawFile();
+	~ofxImageSequenceRawFile();
+
+	//writing, frames must be added in order and all match the size given to create
+	bool create(string path, int numFrames, int width, int height, int channels, ofPixelFormat format = OF_PIXELS_UNKNOWN); //unknown picks gray, rgb or rgba by channels
+	bool appendFrame(const ofPixels& pixels);	//pass unallocated pixels to mark a frame as failed
+	bool finish();
+
+	static bool isRawFile(string path);
+
+	//reading
+	bool open(string path);
+	void close();
+	bool isOpen();
+
+	int getNumFrames();
+	int getWidth();
+	int getHeight();
+	int getNumChannels();
+	ofPixelFormat getPixelFormat();
+	bool isFrameValid(int index);
+	unsigned char* getFrameData(int index);	//points straight into the mapping, valid until close
+
+  protected:
+	ofstream out;
+	int framesWritten;
+
+	unsigned char* mapping;
+	uint64_t mappingSize;
+#ifdef TARGET_WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+	int numFrames;
+	int width;
+	int height;
+	int channels;
+	ofPixelFormat format;
+	uint64_t dataOffset;
+};
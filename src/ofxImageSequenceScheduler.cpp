@@ -0,0 +1,233 @@
+/**
+ *  ofxImageSequenceScheduler.cpp
+ */
+
+#include "ofxImageSequenceScheduler.h"
+
+static thread_local bool workerThread = false;
+
+class ofxImageSequenceSchedulerWorker : public ofThread
+{
+  public:
+
+	ofxImageSequenceScheduler& scheduler;
+	int workerIndex;
+
+	ofxImageSequenceSchedulerWorker(ofxImageSequenceScheduler* s, int index)
+	: scheduler(*s)
+	, workerIndex(index)
+	{
+		startThread(true);
+	}
+
+	void threadedFunction(){
+		workerThread = true;
+		scheduler.runWorker(workerIndex);
+	}
+
+};
+
+ofxImageSequenceScheduler& ofxImageSequenceScheduler::get()
+{
+	//never destroyed, like the shared cache, so sequences torn down during static destruction can still remove themselves
+	static ofxImageSequenceScheduler* scheduler = new ofxImageSequenceScheduler();
+	return *scheduler;
+}
+
+bool ofxImageSequenceScheduler::isWorkerThread()
+{
+	return workerThread;
+}
+
+ofxImageSequenceScheduler::ofxImageSequenceScheduler()
+{
+	numWorkers = MAX((int)thread::hardware_concurrency(), 1);
+	reservedWorkers = 1;
+	busyWorkers = 0;
+	for(int i = 0; i < NUM_PRIORITIES; i++){
+		runningJobs[i] = 0;
+		jobsRun[i] = 0;
+	}
+}
+
+void ofxImageSequenceScheduler::setNumWorkers(int count)
+{
+	ofScopedLock lock(mutex);
+	numWorkers = count > 0 ? count : MAX((int)thread::hardware_concurrency(), 1);
+	if(workers.size() > 0){
+		startWorkers();
+	}
+	//workers past the new count park themselves
+	workAdded.notify_all();
+}
+
+int ofxImageSequenceScheduler::getNumWorkers()
+{
+	ofScopedLock lock(mutex);
+	return numWorkers;
+}
+
+void ofxImageSequenceScheduler::setReservedWorkers(int count)
+{
+	ofScopedLock lock(mutex);
+	reservedWorkers = MAX(count, 0);
+}
+
+int ofxImageSequenceScheduler::getReservedWorkers()
+{
+	ofScopedLock lock(mutex);
+	return reservedWorkers;
+}
+
+void ofxImageSequenceScheduler::addSource(Source* source)
+{
+	ofScopedLock lock(mutex);
+	Entry entry;
+	entry.source = source;
+	entry.removing = false;
+	for(int i = 0; i < NUM_PRIORITIES; i++){
+		entry.running[i] = 0;
+	}
+	sources.push_back(entry);
+	startWorkers();
+	workAdded.notify_all();
+}
+
+void ofxImageSequenceScheduler::removeSource(Source* source)
+{
+	ofScopedLock lock(mutex);
+	for(list<Entry>::iterator it = sources.begin(); it != sources.end(); it++){
+		if(it->source != source){
+			continue;
+		}
+		it->removing = true;
+		while(true){
+			int running = 0;
+			for(int i = 0; i < NUM_PRIORITIES; i++){
+				running += it->running[i];
+			}
+			if(running == 0){
+				break;
+			}
+			jobFinished.wait(lock);
+		}
+		sources.erase(it);
+		return;
+	}
+}
+
+void ofxImageSequenceScheduler::wake()
+{
+	ofScopedLock lock(mutex);
+	workAdded.notify_all();
+}
+
+void ofxImageSequenceScheduler::wakeAt(uint64_t time)
+{
+	ofScopedLock lock(mutex);
+	wakeTimes.insert(time);
+	//an idle worker may be sleeping past the new time
+	workAdded.notify_one();
+}
+
+int ofxImageSequenceScheduler::getBusyWorkers()
+{
+	ofScopedLock lock(mutex);
+	return busyWorkers;
+}
+
+int ofxImageSequenceScheduler::getRunningJobs(Priority priority)
+{
+	ofScopedLock lock(mutex);
+	return runningJobs[priority];
+}
+
+uint64_t ofxImageSequenceScheduler::getJobsRun(Priority priority)
+{
+	ofScopedLock lock(mutex);
+	return jobsRun[priority];
+}
+
+//call with mutex held. workers are started on demand so an app that never loads threaded never pays for them
+void ofxImageSequenceScheduler::startWorkers()
+{
+	while(workers.size() < numWorkers){
+		workers.push_back(new ofxImageSequenceSchedulerWorker(this, workers.size()));
+	}
+}
+
+//call with mutex held. the most urgent job any source has, taking sources in turn so equal priorities share the pool
+bool ofxImageSequenceScheduler::pickJob(list<Entry>::iterator& entry, Priority& priority)
+{
+	//preloads may never fill the whole pool, but a pool of one has to take them
+	int preloadWorkers = numWorkers - MIN(reservedWorkers, numWorkers - 1);
+	for(int p = 0; p < NUM_PRIORITIES; p++){
+		if(p == PRIORITY_PRELOAD && busyWorkers >= preloadWorkers){
+			return false;
+		}
+		for(list<Entry>::iterator it = sources.begin(); it != sources.end(); it++){
+			if(it->removing){
+				continue;
+			}
+			int quota = it->source->getQuota((Priority)p);
+			if(quota >= 0 && it->running[p] >= quota){
+				continue;
+			}
+			if(it->source->hasJob((Priority)p)){
+				//to the back of the line, the next worker looks at the other sources first
+				sources.splice(sources.end(), sources, it);
+				entry = it;
+				priority = (Priority)p;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ofxImageSequenceScheduler::runWorker(int workerIndex)
+{
+	ofScopedLock lock(mutex);
+	while(true){
+		if(workerIndex >= numWorkers){
+			workAdded.wait(lock);
+			continue;
+		}
+
+		list<Entry>::iterator entry;
+		Priority priority;
+		if(!pickJob(entry, priority)){
+			//sources don't always say when work turns up, eg a cache evicting makes room to preload more.
+			//a time asked for with wakeAt is one pass through pickJob, then it's forgotten
+			uint64_t now = ofGetElapsedTimeMicros();
+			if(!wakeTimes.empty() && *wakeTimes.begin() <= now){
+				wakeTimes.erase(wakeTimes.begin(), wakeTimes.upper_bound(now));
+				continue;
+			}
+			uint64_t timeout = 100000;
+			if(!wakeTimes.empty()){
+				timeout = MIN(timeout, *wakeTimes.begin() - now);
+			}
+			workAdded.wait_for(lock, chrono::microseconds(timeout));
+			continue;
+		}
+
+		Source* source = entry->source;
+		entry->running[priority]++;
+		runningJobs[priority]++;
+		busyWorkers++;
+		lock.unlock();
+
+		bool ran = source->runJob(priority);
+
+		lock.lock();
+		//removeSource waits on running, so the entry is still there
+		entry->running[priority]--;
+		runningJobs[priority]--;
+		busyWorkers--;
+		if(ran){
+			jobsRun[priority]++;
+		}
+		jobFinished.notify_all();
+	}
+}
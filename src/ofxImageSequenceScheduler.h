@@ -0,0 +1,79 @@
+/**
+ *  ofxImageSequenceScheduler.h
+ *
+ *  Process wide pool of decode workers shared by every ofxImageSequence. Sequences
+ *  register as job sources and the workers take one frame at a time from whichever
+ *  source has the most urgent work: frames wanted on screen now, then frames the
+ *  playhead is about to reach, then background preloading. Per source quotas and a
+ *  few workers kept back from preloading stop a big load from starving playback.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceScheduler {
+  public:
+
+	enum Priority {
+		PRIORITY_VISIBLE,		//a frame that should be on screen already
+		PRIORITY_PREFETCH,		//frames the playhead is predicted to reach next
+		PRIORITY_PRELOAD,		//everything else a load wants decoded
+		NUM_PRIORITIES
+	};
+
+	//anything with frames to decode. both calls must be thread safe
+	class Source {
+	  public:
+		virtual ~Source(){}
+		virtual bool hasJob(Priority priority) = 0;		//called with the scheduler locked, keep it quick
+		virtual bool runJob(Priority priority) = 0;		//does one unit of work, returns false if there was none left
+		virtual int getQuota(Priority priority) = 0;	//most workers the source may occupy at once at this priority, negative for no limit
+	};
+
+	static ofxImageSequenceScheduler& get();
+	static bool isWorkerThread();	//true on the pool's workers, false on the render thread or anywhere else
+
+	void setNumWorkers(int numWorkers);		//0 or less uses one per core (default)
+	int getNumWorkers();
+	void setReservedWorkers(int numWorkers);	//workers that never take preload jobs so playback always has one free, default is 1
+	int getReservedWorkers();
+
+	//sources must be removed before they're destroyed, removing waits for their running jobs.
+	//never call these or wake while holding a lock the source's hasJob takes
+	void addSource(Source* source);
+	void removeSource(Source* source);
+	void wake();					//a source has new work, rather than waiting for the next poll
+	void wakeAt(uint64_t time);		//a source will have work at this ofGetElapsedTimeMicros time, eg a throttled load's next slot
+
+	int getBusyWorkers();
+	int getRunningJobs(Priority priority);
+	uint64_t getJobsRun(Priority priority);
+
+  protected:
+	friend class ofxImageSequenceSchedulerWorker;
+
+	ofxImageSequenceScheduler();
+
+	struct Entry {
+		Source* source;
+		int running[NUM_PRIORITIES];
+		bool removing;
+	};
+
+	void runWorker(int workerIndex);
+	bool pickJob(list<Entry>::iterator& entry, Priority& priority);
+	void startWorkers();
+
+	ofMutex mutex;
+	condition_variable_any workAdded;
+	condition_variable_any jobFinished;
+	list<Entry> sources;			//in the order they'll next be offered a worker
+	set<uint64_t> wakeTimes;		//from wakeAt, earliest first
+	vector<ofThread*> workers;
+	int numWorkers;
+	int reservedWorkers;
+	int busyWorkers;
+	int runningJobs[NUM_PRIORITIES];
+	uint64_t jobsRun[NUM_PRIORITIES];
+};
@@ -0,0 +1,106 @@
+/**
+ *  ofxImageSequenceSharedCache.cpp
+ */
+
+#include "ofxImageSequenceSharedCache.h"
+#include <sys/stat.h>
+
+ofxImageSequenceSharedCache& ofxImageSequenceSharedCache::get()
+{
+	//never destroyed so sequences that outlive static destruction can still release their frames
+	static ofxImageSequenceSharedCache* cache = new ofxImageSequenceSharedCache();
+	return *cache;
+}
+
+ofxImageSequenceSharedCache::ofxImageSequenceSharedCache()
+{
+	residentBytes = 0;
+	decodesSaved = 0;
+}
+
+string ofxImageSequenceSharedCache::makeKey(string path, string suffix)
+{
+	string fullPath = ofFilePath::getAbsolutePath(ofToDataPath(path));
+	struct stat info;
+	if(stat(fullPath.c_str(), &info) != 0){
+		return fullPath + suffix;
+	}
+	return fullPath + suffix + "|" + ofToString((uint64_t)info.st_size) + "|" + ofToString((uint64_t)info.st_mtime);
+}
+
+shared_ptr<ofPixels> ofxImageSequenceSharedCache::acquire(const string& key, function<bool(ofPixels&)> decode)
+{
+	{
+		ofScopedLock lock(mutex);
+		while(true){
+			map<string, Frame>::iterator it = frames.find(key);
+			if(it != frames.end()){
+				shared_ptr<ofPixels> existing = it->second.pixels.lock();
+				if(existing){
+					decodesSaved++;
+					return existing;
+				}
+			}
+			if(decoding.count(key) == 0){
+				break;
+			}
+			decoded.wait(lock);
+		}
+		decoding.insert(key);
+	}
+
+	ofPixels* pixels = new ofPixels();
+	bool success = decode(*pixels);
+
+	ofScopedLock lock(mutex);
+	decoding.erase(key);
+	decoded.notify_all();
+	if(!success){
+		delete pixels;
+		return shared_ptr<ofPixels>();
+	}
+
+	//the last sequence to let go of the frame removes it from the cache
+	shared_ptr<ofPixels> frame(pixels, bind(&ofxImageSequenceSharedCache::release, this, key, placeholders::_1));
+	Frame& entry = frames[key];
+	if(entry.source != NULL){
+		//an expired frame whose release hasn't run yet, it won't find itself in the cache any more
+		residentBytes -= entry.bytes;
+	}
+	entry.pixels = frame;
+	entry.source = pixels;
+	entry.bytes = pixels->getTotalBytes();
+	residentBytes += entry.bytes;
+	return frame;
+}
+
+void ofxImageSequenceSharedCache::release(const string& key, ofPixels* pixels)
+{
+	{
+		ofScopedLock lock(mutex);
+		map<string, Frame>::iterator it = frames.find(key);
+		if(it != frames.end() && it->second.source == pixels){
+			residentBytes -= it->second.bytes;
+			frames.erase(it);
+		}
+	}
+	delete pixels;
+}
+
+int ofxImageSequenceSharedCache::getNumFrames()
+{
+	ofScopedLock lock(mutex);
+	return frames.size();
+}
+
+uint64_t ofxImageSequenceSharedCache::getResidentBytes()
+{
+	ofScopedLock lock(mutex);
+	return residentBytes;
+}
+
+uint64_t ofxImageSequenceSharedCache::getDecodesSaved()
+{
+	ofScopedLock lock(mutex);
+	return decodesSaved;
+}
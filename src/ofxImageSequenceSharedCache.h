@@ -0,0 +1,46 @@
+/**
+ *  ofxImageSequenceSharedCache.h
+ *
+ *  Process wide cache of decoded frames shared between ofxImageSequence instances
+ *  that point at the same files. Frames are keyed by path, size and modification time
+ *  and reference counted, a frame is freed as soon as no sequence holds it any more.
+ *  When two sequences ask for the same frame at once only one of them decodes it.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceSharedCache {
+  public:
+
+	static ofxImageSequenceSharedCache& get();
+
+	static string makeKey(string path, string suffix = ""); //identifies a file's current contents, changes when the file does
+
+	//returns the cached frame for key, or calls decode to fill in a new one. returns an empty pointer if decode fails
+	shared_ptr<ofPixels> acquire(const string& key, function<bool(ofPixels&)> decode);
+
+	int getNumFrames();				//unique frames currently held by at least one sequence
+	uint64_t getResidentBytes();
+	uint64_t getDecodesSaved();		//frames handed out without decoding because another sequence already had them
+
+  protected:
+	ofxImageSequenceSharedCache();
+
+	struct Frame {
+		Frame() : source(NULL), bytes(0) {}
+		weak_ptr<ofPixels> pixels;
+		ofPixels* source;
+		uint64_t bytes;
+	};
+
+	void release(const string& key, ofPixels* pixels);
+
+	ofMutex mutex;
+	condition_variable_any decoded;
+	map<string, Frame> frames;
+	set<string> decoding;
+	uint64_t residentBytes;
+	uint64_t decodesSaved;
+};
@@ -0,0 +1,83 @@
+/**
+ *  ofxImageSequenceStats.cpp
+ */
+
+#include "ofxImageSequenceStats.h"
+
+ofxImageSequenceStats::ofxImageSequenceStats()
+{
+	windowSize = 512;
+	reset();
+}
+
+void ofxImageSequenceStats::setWindowSize(int samples)
+{
+	ofScopedLock lock(mutex);
+	windowSize = MAX(samples, 1);
+	for(int i = 0; i < NUM_STAGES; i++){
+		this->samples[i].clear();
+		nextSample[i] = 0;
+	}
+}
+
+void ofxImageSequenceStats::addSample(Stage stage, uint64_t micros)
+{
+	ofScopedLock lock(mutex);
+	if(samples[stage].size() < windowSize){
+		samples[stage].push_back(micros);
+	}
+	else{
+		samples[stage][nextSample[stage]] = micros;
+	}
+	nextSample[stage] = (nextSample[stage] + 1) % windowSize;
+	counts[stage]++;
+}
+
+ofxImageSequenceStats::Summary ofxImageSequenceStats::getSummary(Stage stage)
+{
+	vector<uint64_t> sorted;
+	Summary summary;
+	{
+		ofScopedLock lock(mutex);
+		sorted = samples[stage];
+		summary.count = counts[stage];
+	}
+
+	summary.mean = summary.p50 = summary.p95 = summary.p99 = summary.max = 0;
+	if(sorted.size() == 0){
+		return summary;
+	}
+
+	sort(sorted.begin(), sorted.end());
+	uint64_t total = 0;
+	for(int i = 0; i < sorted.size(); i++){
+		total += sorted[i];
+	}
+
+	summary.mean = total / 1000.0 / sorted.size();
+	summary.p50 = sorted[(sorted.size() - 1) * 50 / 100] / 1000.0;
+	summary.p95 = sorted[(sorted.size() - 1) * 95 / 100] / 1000.0;
+	summary.p99 = sorted[(sorted.size() - 1) * 99 / 100] / 1000.0;
+	summary.max = sorted.back() / 1000.0;
+	return summary;
+}
+
+void ofxImageSequenceStats::reset()
+{
+	ofScopedLock lock(mutex);
+	for(int i = 0; i < NUM_STAGES; i++){
+		samples[i].clear();
+		nextSample[i] = 0;
+		counts[i] = 0;
+	}
+}
+
+string ofxImageSequenceStats::getStageName(Stage stage)
+{
+	switch(stage){
+		case STAGE_READ: return "read";
+		case STAGE_DECODE: return "decode";
+		case STAGE_UPLOAD: return "upload";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,46 @@
+/**
+ *  ofxImageSequenceStats.h
+ *
+ *  Rolling timings for each stage a frame goes through on its way to the screen,
+ *  so hitches can be traced to disk reads, decoding or texture uploads at runtime.
+ */
+
+#pragma once
+
+#include "ofMain.h"
+
+class ofxImageSequenceStats {
+  public:
+
+	enum Stage {
+		STAGE_READ,		//reading encoded bytes from disk
+		STAGE_DECODE,	//decoding them into pixels
+		STAGE_UPLOAD,	//copying pixels into the texture
+		NUM_STAGES
+	};
+
+	struct Summary {
+		uint64_t count;		//samples taken since the last reset, not just those in the window
+		float mean;			//the rest are in milliseconds over the rolling window
+		float p50;
+		float p95;
+		float p99;
+		float max;
+	};
+
+	ofxImageSequenceStats();
+
+	void setWindowSize(int samples);	//how many recent samples percentiles are taken over, default is 512
+	void addSample(Stage stage, uint64_t micros);
+	Summary getSummary(Stage stage);
+	void reset();
+
+	static string getStageName(Stage stage);
+
+  protected:
+	ofMutex mutex;
+	int windowSize;
+	vector<uint64_t> samples[NUM_STAGES];
+	int nextSample[NUM_STAGES];
+	uint64_t counts[NUM_STAGES];
+};